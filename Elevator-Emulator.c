@@ -11,37 +11,25 @@
 
 #define F_CPU 8000000L
 
-// Define speed switching details
-#define FAST_SPEED 100
-#define SLOW_SPEED 300
-#define SPEED_SWITCH PC7
-// Define SSD connected pins
-#define SSD_A PC4
-#define SSD_B PD2
-#define SSD_C PD3
-#define SSD_D PC5
-#define SSD_E PD5
-#define SSD_F PD4
-#define SSD_G PC6
-#define SSD_CC PD1
-#define SSD_DP PD0
-// Define destination swithes
-#define SWITCH_S0 PC2
-#define SWITCH_S1 PC3
 // Define buzzer
 #define BUZZER PD7
-// Define LED
-#define LED0 PA0
-#define LED1 PA1
-#define LED2 PA2
-#define LED3 PA3
-// Define queue limitation
-#define MAX_TRAVELLERS 10
+// Holding this button down at reset skips the start screen (as does
+// "boot 1", which sets EEPROM_BOOT_MODE)
+#ifndef FAST_BOOT_BUTTON
+#define FAST_BOOT_BUTTON 3
+#endif
+// Define the most button/serial events handled in one loop pass
+#define INPUT_EVENT_BUDGET 8
+// Define the terminal row used for serial command replies
+#define COMMAND_REPLY_ROW 7
+// Define the serial baud rate at start up (the baud command can change it)
+#define SERIAL_BAUD 19200
 #define MATRIX_WIDTH 8
 
 /* External Library Includes */
 
 #include <avr/io.h>
+#include <avr/eeprom.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <stdio.h>
@@ -51,73 +39,174 @@
 
 /* Internal Library Includes */
 
+#include "animation.h"
 #include "display.h"
 #include "ledmatrix.h"
+#include "matrix_mirror.h"
+#include "profile.h"
+#include "ram.h"
+#include "binlog.h"
 #include "buttons.h"
+#include "checkpoint.h"
+#include "command.h"
+#include "config.h"
+#include "eeprom_map.h"
+#include "inputs.h"
 #include "serialio.h"
+#include "ssd.h"
+#include "telemetry.h"
 #include "terminalio.h"
+#include "termscreen.h"
 #include "timer0.h"
+#include "trace.h"
+
+#if !SERIAL_BAUD_OK(SERIAL_BAUD)
+#error "SERIAL_BAUD can't be generated accurately from F_CPU"
+#endif
 
 /* Data Structures */
 
 typedef enum {UNDEF_FLOOR = -1, FLOOR_0=0, FLOOR_1=4, FLOOR_2=8, FLOOR_3=12} ElevatorFloor;
 
+// Direction of travel (the same values as the telemetry uses)
+typedef enum {
+	DIRECTION_STATIONARY = TLM_DIRECTION_STATIONARY,
+	DIRECTION_UP = TLM_DIRECTION_UP,
+	DIRECTION_DOWN = TLM_DIRECTION_DOWN
+} Direction;
+
+// A traveller is kept as one byte - their origin floor (0-3) in the top
+// four bits and their destination floor in the bottom four
+#define TRIP(origin, destination) (((origin) << 4) | (destination))
+#define TRIP_ORIGIN(trip) ((trip) >> 4)
+#define TRIP_DESTINATION(trip) ((trip) & 0x0F)
+#define TRIP_VALID(trip) (((trip) & 0xCC) == 0)
+// The matrix row a floor (0-3) is on
+#define FLOOR_ROW(floor) ((floor) << 2)
+
+// The elevator's state, a byte (or bit) per field. Positions are matrix
+// rows (0 to 12). The floor and the row within it are kept up to date as
+// the elevator moves (see move_car()), and the direction whenever the
+// position or destination changes, so the main loop never has to work
+// them out.
+typedef struct {
+	uint8_t position;			// Row the elevator is on
+	uint8_t floor;				// Floor at or below it (position / 4)
+	uint8_t sub_row;			// Rows above that floor (position % 4)
+	uint8_t destination;		// Row it is heading for
+	uint8_t direction;			// A Direction
+	uint8_t trip;				// Traveller being served (see TRIP())
+	uint8_t shown_position;		// Position and direction last shown on the
+	uint8_t shown_direction;	// terminal (0xFF to show them again)
+	uint8_t queue_move : 1;		// Serving a traveller
+	uint8_t queue_stage : 1;	// 0 - picking them up, 1 - dropping them off
+	uint8_t door_active : 1;	// Door animation playing
+	uint8_t paused : 1;			// Set over the serial command interface
+	uint8_t fast_boot : 1;		// The start screen was skipped
+} Car;
+
+// The state checkpointed to EEPROM so that the elevator carries on where
+// it was after a reset
+typedef struct {
+	uint8_t position;		// Row
+	uint8_t destination;	// Row
+	uint8_t trip;			// Traveller being served (see TRIP())
+	uint8_t queue_move : 1;
+	uint8_t queue_stage : 1;
+	uint8_t queue_num : 6;
+	uint8_t floors_with_traveller;
+	uint8_t floors_without_traveller;
+	uint8_t queue[MAX_TRAVELLERS];	// Oldest first (see TRIP())
+} CarState;
+
+_Static_assert(sizeof(CarState) <= CHECKPOINT_DATA_SIZE, "CarState doesn't fit in a checkpoint");
+
+// LED animations. The door closed is shown by the middle LEDs and open by
+// the outer ones. The door animations are built from the CONFIG_DOOR_xxx
+// settings (see create_door_animation()) and the elevator waits at a floor
+// until they finish.
+// A fault - three quick pulses of all the LEDs
+static const AnimationFrame fault_animation[] PROGMEM = {
+	ANIMATION_FADE(7, 7, 7, 7, 150),
+	ANIMATION_FRAME(0, 0, 0, 0, 100),
+	ANIMATION_FADE(7, 7, 7, 7, 150),
+	ANIMATION_FRAME(0, 0, 0, 0, 100),
+	ANIMATION_FADE(7, 7, 7, 7, 150),
+	ANIMATION_END
+};
+
 /* Global Variables */
 uint32_t time_since_move;
-ElevatorFloor current_position;
-ElevatorFloor destination;
-ElevatorFloor traveller_floor;
-ElevatorFloor potential_destination;
-// Define a variable and a string to handle the comparison afterward
-int previous_position = -1;
-char previous_direction[11] = "";
-// For traveller status determine
-bool traveller_active;
-bool traveller_moving;
-// Traveller colour
-uint8_t traveller_destination;
-// To toggle the SSD
-bool show_ssd_left = true;
-uint32_t time_since_ssd_toggle;
+Car car = {.shown_position = 0xFF, .shown_direction = 0xFF};
 // To count the floors traveled
 uint8_t floors_with_traveller = 0;
 uint8_t floors_without_traveller = 0;
-uint8_t previous_floor = 0;
-// For door animation status determine
-bool door_active = false;
-uint32_t door_start_time = 0;
+AnimationFrame door_frames[5]; // The door animation playing
 // For queue declarations
-ElevatorFloor queue_origin[MAX_TRAVELLERS];
-ElevatorFloor queue_destination[MAX_TRAVELLERS];
-ElevatorFloor current_origin; // Handle the current traveller
-ElevatorFloor current_destination;
+uint8_t queue_trip[MAX_TRAVELLERS]; // See TRIP()
+uint32_t queue_request_time[MAX_TRAVELLERS]; // Clock tick when each was asked for
+uint32_t current_request_time;
 uint8_t queue_start = 0;
 uint8_t queue_end = 0;
 uint8_t queue_num = 0;
-bool queue_move = false;
-// bool queue_removed = false;
-uint8_t queue_stage = 0; // Indicate the elevator status (picking up/dropping off)
+// Total inputs lost to full buffers when last reported
+uint16_t previous_input_overruns = 0;
+uint16_t input_overrun_offset = 0; // Overruns before the counters were last reset
+// Set over the serial command interface
+uint16_t speed_override = 0; // Row move period in ms, 0 to follow S2
+// Request latencies (ms) - from the button push (or serial input) to the
+// traveller being queued, and to them being picked up
+uint16_t enqueue_latency_max = 0;
+uint16_t pickup_latency_max = 0;
+uint32_t pickup_latency_total = 0;
+uint16_t pickup_count = 0;
+// Time from reset until ready to serve travellers (ms)
+uint32_t boot_time = 0;
+// Travellers restored from the EEPROM checkpoint at start up (0xFF if
+// there wasn't one) and the time that took (us)
+uint8_t restored_travellers = 0xFF;
+uint32_t restore_time = 0;
 
 /* Internal Function Declarations */
 
 void initialise_hardware(void);
+bool fast_boot_selected(void);
 void start_screen(void);
 void start_elevator_emulator(void);
 void handle_inputs(void);
+bool request_traveller(uint8_t origin_floor, uint8_t destination_floor, uint32_t request_time);
+void handle_serial_char(char serial_input);
+void execute_command(Command *cmd);
+uint16_t get_input_overruns(void);
 void draw_elevator(void);
 void draw_floors(void);
-void draw_traveller(void);
-void display_terminal_info(uint8_t current_position, uint8_t destination);
+void display_terminal_info(void);
 uint16_t get_speed(void);
-void direction_ssd(ElevatorFloor current_position, ElevatorFloor destination);
+void set_position(uint8_t row);
+void set_destination(uint8_t row);
+void update_direction(void);
+bool move_car(void);
+void direction_ssd(void);
 uint8_t switch_destination(void);
 uint8_t get_traveller_destination(uint8_t destination);
-void toggle_ssd(void);
 void update_floor_num(void);
+void print_floor_counts(void);
+void report_queue(void);
+void record_pickup_latency(void);
+void dump_trace(void);
+void redraw_terminal(void);
+void run_benchmark(uint16_t bytes);
+void start_reply_row(uint8_t row);
+void print_stats(void);
+void print_profile(void);
+void print_config(void);
 void play_tone(uint16_t frequency, uint16_t duration);
-void create_door_animation(void);
+void create_door_animation(bool boarding);
 void update_door_animation(void);
+void set_fault(uint8_t code);
 void draw_queue_traveller(void);
+void save_checkpoint(void);
+bool restore_checkpoint(void);
 
 /* Main */
 
@@ -126,11 +215,12 @@ int main(void) {
 	// interrupts.
 	initialise_hardware();
 	
-	// Show the splash screen message. Returns when display is complete
-	start_screen();
-	
-	// Initialise the timer
-	init_timer0();
+	// Show the splash screen message (unless fast boot has been chosen).
+	// Returns when display is complete
+	car.fast_boot = fast_boot_selected();
+	if (!car.fast_boot) {
+		start_screen();
+	}
 
 	// Start elevator controller software
 	start_elevator_emulator();
@@ -145,35 +235,23 @@ int main(void) {
 */
 void initialise_hardware(void) {
 	
+	// Start the clock first so the boot time covers everything
+	init_timer0();
+	// Load the tunable settings from EEPROM
+	init_config();
 	ledmatrix_setup();
-	init_button_interrupts();
-	// Setup serial port for 19200 baud communication with no echo
+	init_inputs();
+	// Setup serial port for SERIAL_BAUD baud communication with no echo
 	// of incoming characters
-	init_serial_stdio(19200,0);
+	init_serial_stdio(SERIAL_BAUD,0);
 	
-	init_timer0();
+	init_profile();
 	
 	// Turn on global interrupts
 	sei();
 
-	// Set PortC Pin 7 as input for S2
-	DDRC &= ~(1 << SPEED_SWITCH);
-	PORTC |= (1 << SPEED_SWITCH);
-
-	// Set PortC Pins 0,1,4-6 as outputs for SSD segments
-	DDRC |= (1 << SSD_A) | (1 << SSD_D) |(1 << SSD_G) | (1 << SSD_CC) | (1 << SSD_DP);
-	PORTC &= ~((1 << SSD_A) | (1 << SSD_D) | (1 << SSD_G) | (1 << SSD_CC) | (1 << SSD_DP));
-
-	// Set PortD Pins 4-7 as outputs for SSD segments
-	DDRD |= (1 << SSD_B) | (1 << SSD_C) | (1 << SSD_E) | (1 << SSD_F);
-	PORTD &= ~((1 << SSD_B) | (1 << SSD_C) | (1 << SSD_E) | (1 << SSD_F));
-
-	// Set PortC Pin 2 connect to S0, Pin 3 connect to S1
-	DDRC &= ~((1 << SWITCH_S0) | (1 << SWITCH_S1));
-	PORTC |= (1 << SWITCH_S0) | (1 << SWITCH_S1);
-
-	// Set CC high at first (left SSD is activated)
-	PORTC |= (1 << SSD_CC);
+	// Seven segment display - direction on the left, floor on the right
+	init_ssd();
 
 	// Initialize buzzer
 	DDRD |= (1 << BUZZER);
@@ -181,9 +259,19 @@ void initialise_hardware(void) {
 	TCCR2B = 0;
 	TCNT2 = 0;
 
-	// Initialize LED
-	DDRA |= (1 << LED0) | (1 << LED1) | (1 << LED2) | (1 << LED3);
-	PORTA &= ~((1 << LED0) | (1 << LED1) | (1 << LED2) | (1 << LED3));
+	// Initialize LED animations
+	init_animation();
+}
+
+/**
+ * @brief Checks if the start screen should be skipped - because
+ * FAST_BOOT_BUTTON was held down at reset or fast boot is set in EEPROM
+ * @arg none
+ * @retval true to skip the start screen
+*/
+bool fast_boot_selected(void) {
+	return (inputs_buttons_at_reset() & (1 << FAST_BOOT_BUTTON))
+		|| eeprom_read_byte(EEPROM_BOOT_MODE) == EEPROM_BOOT_FAST;
 }
 
 /**
@@ -202,33 +290,12 @@ void start_screen(void) {
 	// Show start screen
 	start_display();
 	
-	// Animation variables
-	uint32_t doors_frame_time = 0;
-	uint32_t interval_delay = 150;
-	uint8_t frame = 0;
-	uint8_t doors_opening_closing = 1; // 1 => opening, 0 => closing
-	
-	
 	// Wait until a button is pressed, or 's' is pressed on the terminal
 	while(1) {
 		
-		// Don't worry about this if/else tree. Its purely for animating
-		// the elevator doors on the start screen
-		if (get_current_time() - doors_frame_time  > interval_delay) {
-			start_display_animation(frame);
-			doors_frame_time   = get_current_time(); // Reset delay until next movement update
-			if (doors_opening_closing) {
-				interval_delay = 150;
-				frame++;
-				if (frame == 1) interval_delay = 2000;
-				if (frame == 3) doors_opening_closing = 0;
-			} else {
-				interval_delay = 150;
-				frame--;
-				if (frame == 2) interval_delay = 500;
-				if (frame == 0) doors_opening_closing = 1;
-			}
-		}
+		// Animate the elevator doors on the start screen (the frames
+		// and their timing are in tools/splash.txt)
+		start_display_animation();
 	
 		// First check for if a 's' is pressed
 		// There are two steps to this
@@ -259,6 +326,8 @@ void start_elevator_emulator(void) {
 	
 	// Clear the serial terminal
 	clear_terminal();
+	termscreen_clear();
+	matrix_mirror_invalidate();
 	
 	// Initialise Display
 	initialise_display();
@@ -267,65 +336,100 @@ void start_elevator_emulator(void) {
 	// (The cast to void means the return value is ignored.)
 	(void)button_pushed();
 	clear_serial_input_buffer();
+	command_clear();
+
+	// Keep the elevator's timing independent of the terminal - status
+	// output is dropped rather than waiting when the serial port is busy
+	serial_set_tx_policy(SERIAL_TX_DROP_LOW_PRIORITY);
 
 	// Initialise local variables
 	time_since_move = get_current_time();
-	time_since_ssd_toggle = 0;
 	
+	set_position(FLOOR_0);
+	set_destination(FLOOR_0);
+
+	// Carry on from the last checkpoint if there is one
+	uint32_t restore_start = get_current_time_us();
+	bool restored = restore_checkpoint();
+
 	// Draw the floors and elevator
 	draw_elevator();
 	draw_floors();
-	
-	current_position = FLOOR_0;
-	destination = FLOOR_0;
+
+	if (restored) {
+		draw_queue_traveller();
+		report_queue();
+		direction_ssd();
+		print_floor_counts();
+		restored_travellers = queue_num + (car.queue_move && car.queue_stage == 1);
+	}
+	restore_time = get_current_time_us() - restore_start;
+
+	// Ready to serve travellers - report how long that took
+	boot_time = get_current_time();
+	if (!telemetry_binary()) {
+		move_terminal_cursor(1, COMMAND_REPLY_ROW);
+		printf_P(PSTR("Ready %lu ms after reset"), boot_time);
+		if (car.fast_boot) {
+			printf_P(PSTR(" (fast boot)"));
+		}
+		if (restored) {
+			printf_P(PSTR(", restored %u travellers in %lu us"), restored_travellers,
+				restore_time);
+		}
+	}
 	
 	while(true) {
 		update_door_animation();
+		// Write any waiting checkpoint a byte at a time
+		checkpoint_poll();
 
-		if (!queue_move && queue_num > 0) {
-			current_origin = queue_origin[queue_start];
-			current_destination = queue_destination[queue_start];
+		if (!car.paused && !car.queue_move && queue_num > 0) {
+			car.trip = queue_trip[queue_start];
+			current_request_time = queue_request_time[queue_start];
 			// queue_start = (queue_start + 1) % MAX_TRAVELLERS;
 			// queue_num--;
 			// draw_queue_traveller();
 
-			destination = current_origin;
-			queue_move = true;
-			queue_stage = 0;
-			// queue_removed = true;
+			set_destination(FLOOR_ROW(TRIP_ORIGIN(car.trip)));
+			car.queue_move = 1;
+			car.queue_stage = 0;
 		}
 
-		if (!door_active && queue_move && current_position == destination) {
-			play_tone(500, 100);
-			create_door_animation();
+		if (!car.paused && !car.door_active && car.queue_move && car.position == car.destination) {
+			play_tone(config_get(CONFIG_ARRIVE_TONE), config_get(CONFIG_ARRIVE_TONE_MS));
+			create_door_animation(car.queue_stage == 0);
 
-			if(queue_stage == 0) {
+			if(car.queue_stage == 0) {
 				queue_start = (queue_start + 1) % MAX_TRAVELLERS;
 				queue_num--;
 				draw_queue_traveller();
+				report_queue();
+				log_event2(LOG_PICKUP, car.floor, queue_num);
+				trace_event(TRACE_PICKUP, car.floor);
+				record_pickup_latency();
 
-				destination = current_destination;
-				queue_stage = 1;;
+				set_destination(FLOOR_ROW(TRIP_DESTINATION(car.trip)));
+				car.queue_stage = 1;
 			} else {
-				queue_move = false;
+				car.queue_move = 0;
+				log_event1(LOG_DROPOFF, car.floor);
+				trace_event(TRACE_DROPOFF, car.floor);
 			}
+			save_checkpoint();
 		}
 
 		// Move the elevator if there's no active animation
-		if (!door_active) {	
+		if (!car.door_active) {	
 			// Update the Elevator as selected speed
-			if (get_current_time() - time_since_move > get_speed()) {	
+			if (!car.paused && get_current_time() - time_since_move > get_speed()) {	
 				
-				// Adjust the elevator based on where it needs to go
-				if (destination - current_position > 0) { // Move up
-					current_position++;
-				} else if (destination - current_position < 0) { // Move down
-					current_position--;
+				// Move a row towards the destination, and update the
+				// floors travelled if that reached another floor
+				if (move_car()) {
+					update_floor_num();
 				}
 
-				// Update the floor travelled
-				update_floor_num();
-
 				// // Determine the status of traveller
 				// if (traveller_active && current_position == traveller_floor) {
 				// 	// Play tone for pick up
@@ -354,12 +458,10 @@ void start_elevator_emulator(void) {
 				// 	traveller_moving = false;
 				// }
 				
-				direction_ssd(current_position, destination);
+				direction_ssd();
 
 				// As we have potentially changed the elevator position, lets redraw it
 				draw_elevator();
-				// Redraw the traveller
-				draw_traveller();
 
 				time_since_move = get_current_time(); // Reset delay until next movement update
 			}
@@ -368,14 +470,13 @@ void start_elevator_emulator(void) {
 			handle_inputs();
 
 			// Update the terminal info if needed
-			display_terminal_info(current_position, destination);
+			display_terminal_info();
 		}
 
-		// Toggle the SSD frequently to show both at the same time
-		if (get_current_time() - time_since_ssd_toggle > 0.1) {
-			toggle_ssd();
-			_delay_ms(2);  // Use delay to let cpu 'wait' for 1ms
-			time_since_ssd_toggle = get_current_time();
+		// Send any changes to the terminal status lines and matrix mirror
+		if (!telemetry_binary()) {
+			termscreen_refresh();
+			matrix_mirror_refresh();
 		}
 	}
 }
@@ -395,7 +496,7 @@ void draw_floors(void) {
 }
 
 /**
- * @brief Draws the elevator at the current_position
+ * @brief Draws the elevator at car.position
  * @arg none
  * @retval none
 */
@@ -403,33 +504,43 @@ void draw_elevator(void) {
 	
 	// Store where it used to be with old_position
 	static uint8_t old_position; // static variables maintain their value, every time the function is called
+	static uint8_t old_sub_row;
 	
-	int8_t y = 0; // Height position to draw elevator (i.e. y axis)
+	uint8_t y = 0; // Height position to draw elevator (i.e. y axis)
+	uint8_t y_sub_row = 0; // Rows y is above its floor (0 - the floor's LEDs)
 	
 	// Clear where the elevator was
-	if (old_position > current_position) { // Elevator going down - clear above
+	if (old_position > car.position) { // Elevator going down - clear above
 		y = old_position + 3;
-		} else if (old_position < current_position) { // Elevator going up - clear below
+		y_sub_row = (old_sub_row + 3) & 3;
+		} else if (old_position < car.position) { // Elevator going up - clear below
 		y = old_position + 1;
+		y_sub_row = (old_sub_row + 1) & 3;
 	}
-	if (y % 4 != 0) { // Do not draw over the floor's LEDs
+	if (y_sub_row != 0) { // Do not draw over the floor's LEDs
 		update_square_colour(1, y, EMPTY_SQUARE);
 		update_square_colour(2, y, EMPTY_SQUARE);
 	}
-	old_position = current_position;
+	old_position = car.position;
+	old_sub_row = car.sub_row;
 	
 	// Draw a 2x3 block representing the elevator
+	y = car.position;
+	y_sub_row = car.sub_row;
 	for (uint8_t i = 1; i <= 3; i++) { // 3 is the height of the elevator sprite on the LED matrix
-		y = current_position + i; // Adds current floor position to i=1->3 to draw elevator as 3-high block
-		if (y % 4 != 0) { // Do not draw on the floor
-			update_square_colour(1, y, ELEVATOR);
-			update_square_colour(2, y, ELEVATOR); // Elevator is 2 LEDs wide so draw twice
+		y++; // The rows above the current position, i=1->3, draw the elevator as a 3-high block
+		if (++y_sub_row == 4) { // Do not draw on the floor
+			y_sub_row = 0;
+			continue;
 		}
+		update_square_colour(1, y, ELEVATOR);
+		update_square_colour(2, y, ELEVATOR); // Elevator is 2 LEDs wide so draw twice
 	}
 }
 
 /**
- * @brief Reads btn values and serial input and adds a traveller as appropriate
+ * @brief Reads all pending btn values and serial input (up to
+ * INPUT_EVENT_BUDGET events per call) and adds travellers as appropriate
  * @arg none
  * @retval none
 */
@@ -448,100 +559,437 @@ void handle_inputs(void) {
 	 3. Set the destination of the elevator to the FLOOR_X corresponding
 		with the particular button that was pressed.
 	
+	 Both the button queue and the serial input buffer are drained in the
+	 same pass so that a burst of requests doesn't overflow them. The
+	 budget bounds how long a single pass can take.
+	
 	*/
 	
-	// We need to check if any button has been pushed
-	uint8_t btn = button_pushed();
+	for (uint8_t budget = INPUT_EVENT_BUDGET; budget > 0; budget--) {
+		// We need to check if any button has been pushed (and when)
+		uint32_t push_time;
+		int8_t btn = button_pushed_at(&push_time);
+
+		// Collect any serial input
+		char serial_input = -1;
+		if (serial_input_available()) {
+			serial_input = fgetc(stdin);
+		}
 
-	// Collect any serial input
-	char serial_input = -1;
-	if (serial_input_available()) {
-		serial_input = fgetc(stdin);
+		if (btn == NO_BUTTON_PUSHED && serial_input == -1) {
+			break; // Nothing left to handle
+		}
+
+		// Judge the button input
+		if (btn != NO_BUTTON_PUSHED) {
+			request_traveller(btn, switch_destination(), push_time);
+		}
+
+		// Judge the key input
+		if (serial_input != -1) {
+			handle_serial_char(serial_input);
+		}
 	}
 
-	// // Judge the button/key input and traveller status to set destination
-	// if (!traveller_active && !traveller_moving) {
+	// Note any switch changes. The destination switches are read when a
+	// traveller is requested, but a change of speed takes effect now.
+	SwitchEvent change;
+	while (inputs_get_switch_event(&change)) {
+		if ((change.changed & (1 << INPUT_S2)) && speed_override == 0) {
+			log_event1(LOG_SPEED, get_speed());
+		}
+	}
 
-	// Define potential movements
-	uint8_t potential_floor;
-	uint8_t destination_floor;
-	
-	// Judge the button/key input
-	if (btn == BUTTON0_PUSHED || serial_input == '0') {
-		potential_floor = FLOOR_0;
-	} else if (btn == BUTTON1_PUSHED || serial_input == '1') {
-		potential_floor = FLOOR_1;
-	} else if (btn == BUTTON2_PUSHED || serial_input == '2') {
-		potential_floor = FLOOR_2;
-	} else if (btn == BUTTON3_PUSHED || serial_input == '3') {
-		potential_floor = FLOOR_3;
-	} else {
-		return; // No button/key pressed
+	// Report any inputs lost since the last pass
+	uint16_t overruns = get_input_overruns();
+	if (overruns != previous_input_overruns) {
+		if (telemetry_binary()) {
+			print_floor_counts(); // Overruns are part of the metrics record
+		} else {
+			uint8_t x = termscreen_write_P(1, 5, PSTR("Input overruns: "));
+			x = termscreen_write_uint(x, 5, overruns);
+			termscreen_clear_to_end(x, 5);
+		}
+		previous_input_overruns = overruns;
+		log_event1(LOG_INPUT_OVERRUN, overruns);
+		if (overruns != 0) {
+			set_fault(SSD_FAULT_INPUT_OVERRUN);
+		}
 	}
-	
-	// Handle the switch input
-	destination_floor = switch_destination();
-	
+}
+
+/**
+ * @brief Queues a traveller waiting at origin_floor, going to
+ * destination_floor
+ * @arg origin_floor the floor number (0-3) the traveller is waiting on
+ * @arg destination_floor the floor number (0-3) the traveller is going to
+ * @arg request_time the clock tick when the request was made (e.g. when
+ * the button was pushed)
+ * @retval true if the traveller was queued
+*/
+bool request_traveller(uint8_t origin_floor, uint8_t destination_floor, uint32_t request_time) {
 	// Judge if the traveller already on his destination, ignore if so
-	if (potential_floor == destination_floor * 4) {
-		return;
+	if (origin_floor == destination_floor) {
+		return false;
 	}
 
 	// Queue the Traveller if available
-	if (queue_num < MAX_TRAVELLERS) {
-        queue_origin[queue_end] = (ElevatorFloor)(potential_floor);
-        queue_destination[queue_end] = (ElevatorFloor)(destination_floor * 4); // Convert 0-3 to 0-12
+	if (queue_num < config_get(CONFIG_MAX_TRAVELLERS)) {
+        queue_trip[queue_end] = TRIP(origin_floor, destination_floor);
+        queue_request_time[queue_end] = request_time;
         queue_end = (queue_end + 1) % MAX_TRAVELLERS; // Put the next Traveller's info in nect slot
         queue_num++;
 
         // feedback & redraw
-        play_tone(3000, 50);
+        play_tone(config_get(CONFIG_QUEUE_TONE), config_get(CONFIG_QUEUE_TONE_MS));
         draw_queue_traveller();
+        report_queue();
+        log_event3(LOG_QUEUED, origin_floor, destination_floor, queue_num);
+        trace_event(TRACE_ENQUEUE, TRIP(origin_floor, destination_floor));
+
+        uint32_t latency = get_current_time() - request_time;
+        if (latency > enqueue_latency_max) {
+            enqueue_latency_max = latency > 0xFFFF ? 0xFFFF : latency;
+        }
+        save_checkpoint();
+        return true;
     }
+    trace_event(TRACE_OVERFLOW, TRACE_OVERFLOW_TRAVELLERS);
+    set_fault(SSD_FAULT_QUEUE_FULL);
+    log_event3(LOG_QUEUE_REJECTED, origin_floor, destination_floor, queue_num);
+    return false;
+}
 
-	// 	// Play tone for traveller putted
-	// 	play_tone(3000, 50);
+/**
+ * @brief Handles one character of serial input. '0'-'3' at the start of a
+ * line queue a traveller straight away (going to the floor selected by the
+ * switches), anything else is collected into a command line
+ * @arg serial_input the character received
+ * @retval none
+*/
+void handle_serial_char(char serial_input) {
+	if (command_line_empty() && serial_input >= '0' && serial_input <= '3') {
+		request_traveller(serial_input - '0', switch_destination(),
+			get_current_time());
+		return;
+	}
 
-	// 	// Create the traveller
-	// 	traveller_active = true;
-	// 	traveller_floor = potential_floor;
-	// 	destination = traveller_floor;
-	// 	traveller_destination = get_traveller_destination(destination_floor); // Used to indicate the colour
+	Command cmd;
+	if (command_add_char(serial_input, &cmd)) {
+		execute_command(&cmd);
+	}
+}
 
+/**
+ * @brief Carries out a command received over serial and prints the reply
+ * @arg cmd the parsed command
+ * @retval none
+*/
+void execute_command(Command *cmd) {
+	bool ok = true;
+	uint32_t new_baud = 0; // Changed after the reply has been sent
 
-	// }
-	
-}
+	if (!telemetry_binary()) {
+		move_terminal_cursor(1, COMMAND_REPLY_ROW);
+		clear_to_end_of_line();
+	}
 
-// Called to display infos in serial terminal (putty)
-void display_terminal_info(uint8_t current_position, uint8_t destination) {
-	// Set a pointer for strings refering later
-	const char *direction;
-
-	// Compare current position to determine the direction
-	if (current_position < destination) {
-		direction = "Up";
-	}  else if (current_position > destination) {
-		direction = "Down";
+	switch (cmd->id) {
+		case CMD_ENQUEUE:
+			// enq <origin> <destination>
+			ok = cmd->num_args == 2 && cmd->args[0] <= 3 && cmd->args[1] <= 3
+				&& request_traveller(cmd->args[0], cmd->args[1],
+					get_current_time());
+			break;
+		case CMD_BATCH:
+			// batch <origin> <destination> ... - stops at the first traveller
+			// that can't be queued
+			ok = cmd->num_args >= 2 && cmd->num_args % 2 == 0;
+			for (uint8_t i = 0; ok && i < cmd->num_args; i += 2) {
+				ok = cmd->args[i] <= 3 && cmd->args[i + 1] <= 3
+					&& request_traveller(cmd->args[i], cmd->args[i + 1],
+						get_current_time());
+			}
+			break;
+		case CMD_SPEED:
+			// speed [<ms>] - no argument (or 0) goes back to switch S2
+			if (cmd->num_args == 0) {
+				speed_override = 0;
+			} else if (cmd->num_args == 1 && cmd->args[0] <= 10000) {
+				speed_override = cmd->args[0];
+			} else {
+				ok = false;
+			}
+			log_event1(LOG_SPEED, get_speed());
+			break;
+		case CMD_STATS:
+			if (telemetry_binary()) {
+				print_floor_counts();
+				report_queue();
+			} else {
+				print_stats();
+			}
+			break;
+		case CMD_RESET:
+			floors_with_traveller = 0;
+			floors_without_traveller = 0;
+			enqueue_latency_max = 0;
+			pickup_latency_max = 0;
+			pickup_latency_total = 0;
+			pickup_count = 0;
+			input_overrun_offset += get_input_overruns();
+			set_fault(SSD_FAULT_NONE);
+			print_floor_counts();
+			break;
+		case CMD_PAUSE:
+			// pause [0|1] - no argument toggles
+			if (cmd->num_args == 0) {
+				car.paused = !car.paused;
+			} else if (cmd->num_args == 1 && cmd->args[0] <= 1) {
+				car.paused = cmd->args[0];
+			} else {
+				ok = false;
+			}
+			log_event1(LOG_PAUSE, car.paused);
+			break;
+		case CMD_TELEMETRY:
+			// telemetry [0|1] - no argument toggles
+			if (cmd->num_args == 0) {
+				telemetry_set_binary(!telemetry_binary());
+			} else if (cmd->num_args == 1 && cmd->args[0] <= 1) {
+				telemetry_set_binary(cmd->args[0]);
+			} else {
+				ok = false;
+				break;
+			}
+			if (telemetry_binary()) {
+				report_queue(); // Give the host the full state to start from
+				print_floor_counts();
+			} else {
+				redraw_terminal();
+			}
+			break;
+		case CMD_TXPOLICY:
+			// txpolicy <0|1|2> - see SerialTxPolicy
+			ok = cmd->num_args == 1 && cmd->args[0] <= SERIAL_TX_DROP_LOW_PRIORITY;
+			if (ok) {
+				serial_set_tx_policy((SerialTxPolicy)cmd->args[0]);
+			}
+			break;
+		case CMD_REFRESH:
+			// refresh [<ms>] - minimum time between terminal status updates
+			if (cmd->num_args == 0) {
+				termscreen_set_refresh_period(TERMSCREEN_REFRESH_PERIOD);
+			} else if (cmd->num_args == 1 && cmd->args[0] <= 10000) {
+				termscreen_set_refresh_period(cmd->args[0]);
+			} else {
+				ok = false;
+			}
+			break;
+		case CMD_MIRROR:
+			// mirror [<ms>] - minimum time between LED matrix mirror frames
+			if (cmd->num_args == 0) {
+				matrix_mirror_set_period(MATRIX_MIRROR_PERIOD);
+			} else if (cmd->num_args == 1 && cmd->args[0] <= 10000) {
+				matrix_mirror_set_period(cmd->args[0]);
+			} else {
+				ok = false;
+			}
+			break;
+		case CMD_FLOW:
+			// flow [0|1] - XON/XOFF input flow control, no argument toggles
+			if (cmd->num_args == 0) {
+				serial_set_flow_control(!serial_get_flow_control());
+			} else if (cmd->num_args == 1 && cmd->args[0] <= 1) {
+				serial_set_flow_control(cmd->args[0]);
+			} else {
+				ok = false;
+			}
+			break;
+		case CMD_BAUD:
+			// baud <rate> - the reply is sent at the old rate
+			ok = cmd->num_args == 1 && cmd->args[0] > 0
+				&& serial_baud_error(cmd->args[0]) <= SERIAL_MAX_BAUD_ERROR;
+			if (ok) {
+				new_baud = cmd->args[0];
+			}
+			break;
+		case CMD_BENCH:
+			// bench <bytes> - text mode only, the pattern would break up
+			// the binary records
+			ok = !telemetry_binary() && cmd->num_args == 1 && cmd->args[0] > 0
+				&& cmd->args[0] <= 60000;
+			if (ok) {
+				run_benchmark(cmd->args[0]);
+			}
+			break;
+		case CMD_SSD:
+			// ssd <digit> <mode> [<glyph>] - digit 0 is the left, the
+			// glyph is only given for SSD_MODE_GLYPH
+			ok = (cmd->num_args == 2 || cmd->num_args == 3) && cmd->args[0] <= SSD_RIGHT
+				&& cmd->args[1] < SSD_NUM_MODES
+				&& (cmd->num_args == 3) == (cmd->args[1] == SSD_MODE_GLYPH)
+				&& (cmd->num_args == 2 || cmd->args[2] < SSD_NUM_GLYPHS);
+			if (ok) {
+				if (cmd->num_args == 3) {
+					ssd_set_glyph((SsdDigit)cmd->args[0], (SsdGlyph)cmd->args[2]);
+				}
+				ssd_set_mode((SsdDigit)cmd->args[0], (SsdMode)cmd->args[1]);
+			}
+			break;
+		case CMD_BRIGHT:
+			// bright [<level>] - no argument for the default
+			if (cmd->num_args == 0) {
+				ssd_set_brightness(SSD_BRIGHTNESS_DEFAULT);
+			} else if (cmd->num_args == 1 && cmd->args[0] <= SSD_BRIGHTNESS_MAX) {
+				ssd_set_brightness(cmd->args[0]);
+			} else {
+				ok = false;
+			}
+			break;
+		case CMD_BOOT:
+			// boot <0|1> - 1 to skip the start screen from the next reset
+			ok = cmd->num_args == 1 && cmd->args[0] <= 1;
+			if (ok) {
+				eeprom_update_byte(EEPROM_BOOT_MODE, cmd->args[0] ? EEPROM_BOOT_FAST : 0xFF);
+			}
+			break;
+		case CMD_CHECKPOINT:
+			// ckpt - show the checkpoint statistics, ckpt 0 - discard the
+			// checkpoint so the next reset starts afresh
+			if (cmd->num_args == 0 && !telemetry_binary()) {
+				CheckpointStats checkpoint;
+				checkpoint_get_stats(&checkpoint);
+				// Too long for one row, so the restore goes on the next
+				start_reply_row(COMMAND_REPLY_ROW + 1);
+				printf_P(PSTR("restored:%u in %luus"),
+					restored_travellers == 0xFF ? 0 : restored_travellers, restore_time);
+				move_terminal_cursor(1, COMMAND_REPLY_ROW);
+				printf_P(PSTR("saves:%u writes:%u bytes:%u skipped:%u last:%ums seq:%u "),
+					checkpoint.saves, checkpoint.writes, checkpoint.bytes_written,
+					checkpoint.bytes_skipped, checkpoint.last_write_ms, checkpoint.sequence);
+			} else if (cmd->num_args == 1 && cmd->args[0] == 0) {
+				checkpoint_discard();
+			} else {
+				ok = false;
+			}
+			break;
+		case CMD_CONFIG:
+			// cfg - list the settings, cfg <item> - put one back to its
+			// default, cfg <item> <value> - change one (saved to EEPROM)
+			if (cmd->num_args == 0 && !telemetry_binary()) {
+				print_config();
+			} else if (cmd->num_args == 1 && cmd->args[0] < CONFIG_NUM_ITEMS) {
+				config_set_default(cmd->args[0]);
+			} else if (cmd->num_args == 2 && cmd->args[0] < CONFIG_NUM_ITEMS
+					&& cmd->args[1] <= 0xFFFF) {
+				ok = config_set(cmd->args[0], cmd->args[1]);
+			} else {
+				ok = false;
+			}
+			break;
+		case CMD_RAM:
+			// ram - show how much RAM is used (text mode only)
+			if (cmd->num_args == 0 && !telemetry_binary()) {
+				RamUsage ram;
+				ram_get_usage(&ram);
+				printf_P(PSTR("data:%u bss:%u heap:%u stack:%u maxstack:%u minfree:%u "),
+					ram.data, ram.bss, ram.heap, ram.stack_now, ram.stack_max, ram.free_min);
+			} else {
+				ok = false;
+			}
+			break;
+		case CMD_PROFILE:
+			// profile - show interrupt handler timings, profile 0 - clear
+			// them (only if built with PROFILE defined, text mode only)
+#ifdef PROFILE
+			if (cmd->num_args == 0 && !telemetry_binary()) {
+				print_profile();
+			} else if (cmd->num_args == 1 && cmd->args[0] == 0) {
+				profile_clear();
+			} else {
+				ok = false;
+			}
+#else
+			ok = false;
+#endif
+			break;
+		case CMD_TRACE:
+			// trace - dump, trace 0 - clear
+			if (cmd->num_args == 0) {
+				dump_trace();
+			} else if (cmd->num_args == 1 && cmd->args[0] == 0) {
+				trace_clear();
+			} else {
+				ok = false;
+			}
+			break;
+		default:
+			ok = false;
+			break;
+	}
+
+	if (telemetry_binary()) {
+		uint8_t reply[2] = {cmd->id, ok};
+		telemetry_send(TLM_REPLY, reply, sizeof(reply));
 	} else {
-		direction = "Stationary";
+		if (ok) {
+			serial_write_P(PSTR("OK"));
+		} else {
+			serial_write_P(PSTR("ERR"));
+		}
+		// The reply row runs across the matrix mirror
+		matrix_mirror_invalidate_row(COMMAND_REPLY_ROW);
 	}
 
-	// Convert the matrix position into floor number
-	int8_t floor_number = ((int)current_position) / 4;
+	if (new_baud != 0) {
+		serial_set_baud(new_baud);
+	}
+}
 
-	if (current_position != previous_position || strcmp(previous_direction, direction) != 0) { // Compare the current info with previous one to see if update needed
-		move_terminal_cursor(1, 1);  // Allocate the infos at the correct place
-		printf_P(PSTR("Current Floor: %u   "), floor_number);  // Put some space after to overwrite the previous printing
+// Called to get the number of inputs lost since the counters were reset
+uint16_t get_input_overruns(void) {
+	return button_queue_overruns() + serial_input_overrun_count()
+		+ serial_hardware_overrun_count() - input_overrun_offset;
+}
 
-		move_terminal_cursor(1, 2);  // Print the direction info at next line
-		printf_P(PSTR("Direction: %s        "), direction);
+// Names of the TLM_DIRECTION_xxx values for the terminal
+static const char direction_names[3][11] PROGMEM = {
+	"Stationary",
+	"Up",
+	"Down"
+};
 
-		// Save the current infos for comparison
-		strncpy(previous_direction, direction, sizeof(previous_direction));
-		previous_position = current_position;
+// Called to display infos in serial terminal (putty)
+void display_terminal_info(void) {
+	// Nothing to do unless the elevator has moved or changed direction
+	if (car.position == car.shown_position && car.direction == car.shown_direction) {
+		return;
 	}
 
+	if (telemetry_binary()) {
+		// Send only the records that have changed
+		if (car.position != car.shown_position) {
+			uint8_t position[2] = {car.position, car.floor};
+			telemetry_send(TLM_POSITION, position, sizeof(position));
+		}
+		if (car.direction != car.shown_direction) {
+			telemetry_send(TLM_DIRECTION, &car.direction, 1);
+		}
+	} else {
+		// Update the status lines - termscreen_refresh() sends whatever
+		// has actually changed
+		uint8_t x = termscreen_write_P(1, 1, PSTR("Current Floor: "));
+		x = termscreen_write_uint(x, 1, car.floor);
+		termscreen_clear_to_end(x, 1);
+
+		x = termscreen_write_P(1, 2, PSTR("Direction: "));
+		x = termscreen_write_P(x, 2, direction_names[car.direction]);
+		termscreen_clear_to_end(x, 2);
+	}
+	car.shown_direction = car.direction;
+	car.shown_position = car.position;
+
 	/*int8_t previous_floor = 0;
 	if (floor_number != previous_floor) {
 		if (traveller_moving) {
@@ -559,43 +1007,85 @@ void display_terminal_info(uint8_t current_position, uint8_t destination) {
 	}**/
 }
 
-// Called to draw the traveller
-void draw_traveller(void) {
-	if (traveller_active) {
-		int8_t y = traveller_floor + 1;
-		update_square_colour(4, y, traveller_destination); // Draw as destination indicated
-	}
-}
-
-// Called for speed switch
+// Called for speed switch (unless the speed has been set over serial)
 uint16_t get_speed(void) {
-	if ((PINC & (1 << SPEED_SWITCH)) == 0) { // Use bit masking to judge if the switch is 0/1
-		return SLOW_SPEED;
+	if (speed_override != 0) {
+		return speed_override;
+	}
+	if ((inputs_switches() & (1 << INPUT_S2)) == 0) { // Use bit masking to judge if the switch is 0/1
+		return config_get(CONFIG_SLOW_SPEED);
 	} else {
-		return FAST_SPEED;
+		return config_get(CONFIG_FAST_SPEED);
 	}
 }
 
-// Called for left ssd
-void direction_ssd(ElevatorFloor current_position, ElevatorFloor destination) {
-	// Clear the segments
-	PORTC &= ~((1 << SSD_A) | (1 << SSD_D) | (1 << SSD_G));
+// Called to put the elevator on a row (not moving it there - see move_car())
+void set_position(uint8_t row) {
+	car.position = row;
+	car.floor = row >> 2;
+	car.sub_row = row & 3;
+	update_direction();
+}
+
+// Called to send the elevator to a row
+void set_destination(uint8_t row) {
+	car.destination = row;
+	update_direction();
+}
 
-	// Judge which segment turns on
-	if (destination > current_position) {
-		PORTC |= (1 << SSD_A);
-	} else if (destination < current_position) {
-		PORTC |= (1 << SSD_D);
+// Called to work out the direction of travel after the position or
+// destination has changed
+void update_direction(void) {
+	if (car.destination > car.position) {
+		car.direction = DIRECTION_UP;
+	} else if (car.destination < car.position) {
+		car.direction = DIRECTION_DOWN;
 	} else {
-		PORTC |= (1 << SSD_G);
+		car.direction = DIRECTION_STATIONARY;
 	}
 }
 
+// Called to move the elevator a row towards its destination. Returns true
+// if that changed the floor (the floor at or below the elevator).
+bool move_car(void) {
+	bool new_floor = false;
+	if (car.direction == DIRECTION_UP) {
+		car.position++;
+		if (++car.sub_row == 4) {
+			car.sub_row = 0;
+			car.floor++;
+			new_floor = true;
+		}
+	} else if (car.direction == DIRECTION_DOWN) {
+		car.position--;
+		if (car.sub_row-- == 0) {
+			car.sub_row = 3;
+			car.floor--;
+			new_floor = true;
+		}
+	}
+	if (car.position == car.destination) {
+		car.direction = DIRECTION_STATIONARY;
+	}
+	return new_floor;
+}
+
+// Glyphs for the Direction values
+static const uint8_t direction_glyphs[3] PROGMEM = {
+	SSD_GLYPH_STOPPED,
+	SSD_GLYPH_UP,
+	SSD_GLYPH_DOWN
+};
+
+// Called for the ssd direction and floor
+void direction_ssd(void) {
+	ssd_set_direction(pgm_read_byte(&direction_glyphs[car.direction]));
+	ssd_set_floor(car.floor);
+}
+
 // Handle switch input
 uint8_t switch_destination(void) {
-	uint8_t s0 = (PINC >> SWITCH_S0) & 1;
-	uint8_t s1 = (PINC >> SWITCH_S1) & 1;
-	return (s1 << 1) | s0;
+	return inputs_switches() & ((1 << INPUT_S1) | (1 << INPUT_S0));
 }
 
 // Get corresponding traveller destination type (as object)
@@ -609,67 +1099,235 @@ uint8_t get_traveller_destination(uint8_t destination) {
 	}
 }
 
-// Set the Port C and Port D digits for corresponding SSD display (0, 1, 2, 3)
-uint8_t portc_digit[4] = {
-	(1 << SSD_A) | (1 << SSD_D),
-	0,
-	(1 << SSD_A) | (1 << SSD_D) | (1 << SSD_G),
-	(1 << SSD_A) | (1 << SSD_D) | (1 << SSD_G)
-};
-uint8_t portd_digit[4] = {
-	(1 << SSD_B) | (1 << SSD_C) | (1 << SSD_E) | (1 << SSD_F),
-	(1 << SSD_B) | (1 << SSD_C),
-	(1 << SSD_B) | (1 << SSD_E),
-	(1 << SSD_B) | (1 << SSD_C)
-};
-
-// Called for switching the left and right SSD
-void toggle_ssd(void) {
-	// Clear the CC
-	PORTC &= ~(1 << SSD_CC);
-	// Clear the segments
-	PORTC &= ~((1 << SSD_A) | (1 << SSD_D) | (1 << SSD_G) | (1 << SSD_DP));
-	PORTD &= ~((1 << SSD_B) | (1 << SSD_C) | (1 << SSD_E) | (1 << SSD_F));
-
-	if (show_ssd_left) {
-		// Show the direction
-		direction_ssd(current_position, destination);
-		PORTC |= (1 << SSD_CC);
-		PORTC &= ~(1 << SSD_DP);
+// Called for update floor travelling infos (when the elevator reaches
+// another floor)
+void update_floor_num(void) {
+	// if (traveller_moving) { // Judge if the elevator moved any tranveller
+	if (car.queue_move && car.queue_stage == 1) {
+		floors_with_traveller++;
 	} else {
-		// Show the floor currently in
-		uint8_t floor_num = current_position / 4;
-		PORTC |= portc_digit[floor_num];
-		PORTD |= portd_digit[floor_num];
-		PORTC |= (1 << SSD_DP);
-		PORTC &= ~(1 << SSD_CC);
+		floors_without_traveller++;
 	}
-	// Toggle the ssd
-	show_ssd_left = !show_ssd_left;
+
+	// Placed the info shown in the terminal with an appropriate way
+	print_floor_counts();
 }
 
-// Called for update floor travelling infos
-void update_floor_num(void) {
-	int8_t current_floor = current_position / 4; // Set for later comparison
-	if  (current_floor != previous_floor) {
-		// if (traveller_moving) { // Judge if the elevator moved any tranveller
-		if (queue_move && queue_stage == 1) {
-			floors_with_traveller++;
-		} else {
-			floors_without_traveller++;
+// Called to show the floor travelling infos in the terminal (or send them
+// as a metrics record)
+void print_floor_counts(void) {
+	if (telemetry_binary()) {
+		uint16_t overruns = get_input_overruns();
+		uint8_t metrics[4] = {floors_with_traveller, floors_without_traveller,
+			overruns & 0xFF, overruns >> 8};
+		telemetry_send(TLM_METRICS, metrics, sizeof(metrics));
+		return;
+	}
+	uint8_t x = termscreen_write_P(1, 3, PSTR("Floors with Traveller: "));
+	x = termscreen_write_uint(x, 3, floors_with_traveller);
+	termscreen_clear_to_end(x, 3);
+	x = termscreen_write_P(1, 4, PSTR("Floors without Traveller: "));
+	x = termscreen_write_uint(x, 4, floors_without_traveller);
+	termscreen_clear_to_end(x, 4);
+}
+
+// Called when the current traveller is picked up to record how long it
+// took from their request
+void record_pickup_latency(void) {
+	uint32_t latency = get_current_time() - current_request_time;
+	if (latency > 0xFFFF) {
+		latency = 0xFFFF;
+	}
+	if (latency > pickup_latency_max) {
+		pickup_latency_max = latency;
+	}
+	pickup_latency_total += latency;
+	pickup_count++;
+	log_event1(LOG_PICKUP_LATENCY, latency);
+}
+
+// Called to send the waiting travellers as a queue record
+void report_queue(void) {
+	ssd_set_queue(queue_num);
+
+	uint8_t queue_record[MAX_TRAVELLERS + 1];
+	queue_record[0] = queue_num;
+	for (uint8_t i = 0; i < queue_num; i++) {
+		uint8_t queue_slot = (queue_start + i) % MAX_TRAVELLERS;
+		queue_record[i + 1] = queue_trip[queue_slot];
+	}
+	telemetry_send(TLM_QUEUE, queue_record, queue_num + 1);
+}
+
+// Called to print the event trace (oldest first) below the command reply,
+// or send it as trace records
+void dump_trace(void) {
+	TraceRecord record;
+	uint8_t count = trace_count();
+
+	// Stop recording so the trace doesn't move while we read it
+	trace_hold(1);
+	if (telemetry_binary()) {
+		uint8_t chunk[1 + 5 * sizeof(TraceRecord)];
+		for (uint8_t i = 0; i < count; i += 5) {
+			uint8_t length = 1;
+			chunk[0] = i;
+			for (uint8_t j = i; j < count && j < i + 5; j++) {
+				trace_get(j, &record);
+				chunk[length++] = record.delta & 0xFF;
+				chunk[length++] = record.delta >> 8;
+				chunk[length++] = record.type;
+				chunk[length++] = record.arg;
+			}
+			telemetry_send(TLM_TRACE, chunk, length);
 		}
-		previous_floor = current_floor;
+	} else {
+		for (uint8_t i = 0; i < count; i++) {
+			trace_get(i, &record);
+			move_terminal_cursor(1, COMMAND_REPLY_ROW + 1 + i);
+			printf_P(PSTR("+%u "), record.delta);
+			fputs_P(trace_event_name(record.type), stdout);
+			printf_P(PSTR(" %u"), record.arg);
+			clear_to_end_of_line();
+			matrix_mirror_invalidate_row(COMMAND_REPLY_ROW + 1 + i);
+		}
+		move_terminal_cursor(1, COMMAND_REPLY_ROW);
+	}
+	trace_hold(0);
+}
 
-		// Placed the info shown in the terminal with an appropriate way
-		move_terminal_cursor(1, 3);
-		printf_P(PSTR("Floors with Traveller: %u"), floors_with_traveller);
-		move_terminal_cursor(1, 4);
-		printf_P(PSTR("Floors without Traveller: %u"), floors_without_traveller);
+// Called to clear the terminal and draw all of the terminal info again
+void redraw_terminal(void) {
+	clear_terminal();
+	termscreen_invalidate();
+	matrix_mirror_invalidate();
+	print_floor_counts();
+	car.shown_position = 0xFF;
+	previous_input_overruns = 0xFFFF;
+	move_terminal_cursor(1, COMMAND_REPLY_ROW);
+}
+
+// Called to send bytes of a test pattern as fast as the serial port
+// allows and report how long it took (tools/serial_bench.py runs this at
+// each baud rate). The pattern scrolls the terminal, so it is redrawn
+// afterwards.
+void run_benchmark(uint16_t bytes) {
+	static const char pattern[] PROGMEM =
+		"0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ\n";
+	char line[sizeof(pattern) - 1];
+	memcpy_P(line, pattern, sizeof(line));
+
+	// None of the pattern may be dropped
+	SerialTxPolicy policy = serial_get_tx_policy();
+	serial_set_tx_policy(SERIAL_TX_BLOCK);
+	uint32_t start = get_current_time();
+	for (uint16_t sent = 0; sent < bytes; sent += sizeof(line)) {
+		uint16_t length = bytes - sent;
+		serial_write(line, length < sizeof(line) ? length : sizeof(line));
+	}
+	while (serial_tx_queued() > 0) {
+		; // Wait for the output buffer to empty
+	}
+	uint32_t elapsed = get_current_time() - start;
+	serial_set_tx_policy(policy);
+
+	redraw_terminal();
+	printf_P(PSTR("bench:%u baud:%lu ms:%lu bytes/s:%lu "), bytes, serial_get_baud(),
+		elapsed, elapsed ? bytes * 1000UL / elapsed : 0);
+}
+
+// Called to move to a row below the command reply row for more of a
+// reply, clearing it. The row runs across the matrix mirror, so that is
+// drawn again
+void start_reply_row(uint8_t row) {
+	move_terminal_cursor(1, row);
+	clear_to_end_of_line();
+	matrix_mirror_invalidate_row(row);
+}
+
+// Called to print the statistics below the command reply, a group per row
+// (they are too long for one)
+void print_stats(void) {
+	uint8_t row = COMMAND_REPLY_ROW + 1;
+	start_reply_row(row++);
+	printf_P(PSTR("with:%u without:%u queued:%u overruns:%u speed:%u paused:%u"),
+		floors_with_traveller, floors_without_traveller, queue_num,
+		get_input_overruns(), get_speed(), car.paused);
+	start_reply_row(row++);
+	printf_P(PSTR("txqueued:%u txdropped:%u/%u"), serial_tx_queued(),
+		serial_tx_dropped_bytes(), serial_tx_dropped_messages());
+	start_reply_row(row++);
+	printf_P(PSTR("rxoverrun:%u/%u framing:%u xoff:%u bounces:%u"),
+		serial_input_overrun_count(), serial_hardware_overrun_count(),
+		serial_framing_error_count(), serial_xoff_count(),
+		button_bounces_rejected());
+	start_reply_row(row++);
+	printf_P(PSTR("latency queue:%u pickup:%lu/%u"), enqueue_latency_max,
+		pickup_count ? pickup_latency_total / pickup_count : 0, pickup_latency_max);
+	start_reply_row(row++);
+	printf_P(PSTR("boot:%lu fastboot:%u"), boot_time, car.fast_boot);
+	CheckpointStats checkpoint;
+	checkpoint_get_stats(&checkpoint);
+	printf_P(PSTR(" ckpt:%u/%u"), checkpoint.writes, checkpoint.last_write_ms);
+	move_terminal_cursor(1, COMMAND_REPLY_ROW);
+}
+
+// Called to print the interrupt handler timings below the command reply
+void print_profile(void) {
+#ifdef PROFILE
+	ProfileStats stats;
+	uint8_t row = COMMAND_REPLY_ROW + 1;
+	for (uint8_t slot = 0; slot < PROFILE_NUM_SLOTS; slot++, row++) {
+		profile_get(slot, &stats);
+		move_terminal_cursor(1, row);
+		fputs_P(profile_slot_name(slot), stdout);
+		printf_P(PSTR(" n:%u max:%u avg:%lu cycles"), stats.count, stats.max_cycles,
+			stats.count ? stats.total_cycles / stats.count : 0);
+		clear_to_end_of_line();
+		matrix_mirror_invalidate_row(row);
+	}
+	// Timer 0 counts every 64 cycles
+	move_terminal_cursor(1, row);
+	printf_P(PSTR("tick latency max:%lu us"), profile_get_tick_latency() * 64000000UL / F_CPU);
+	clear_to_end_of_line();
+	matrix_mirror_invalidate_row(row);
+	move_terminal_cursor(1, COMMAND_REPLY_ROW);
+#endif
+}
+
+// Called to list the settings, one per row below the command reply row,
+// with where they came from on the reply row
+void print_config(void) {
+	uint8_t row = COMMAND_REPLY_ROW + 1;
+	for (uint8_t item = 0; item < CONFIG_NUM_ITEMS; item++, row++) {
+		move_terminal_cursor(1, row);
+		printf_P(PSTR("%u "), item);
+		fputs_P(config_name(item), stdout);
+		printf_P(PSTR(" %u (%u-%u, default %u)"), config_get(item), config_min(item),
+			config_max(item), config_default(item));
+		clear_to_end_of_line();
+		matrix_mirror_invalidate_row(row);
+	}
+	move_terminal_cursor(1, COMMAND_REPLY_ROW);
+	switch (config_source()) {
+		case CONFIG_FROM_EEPROM:
+			printf_P(PSTR("settings from EEPROM "));
+			break;
+		case CONFIG_DEFAULTS_BLANK:
+			printf_P(PSTR("default settings (none saved) "));
+			break;
+		case CONFIG_DEFAULTS_VERSION:
+			printf_P(PSTR("default settings (saved for another version) "));
+			break;
+		default:
+			printf_P(PSTR("default settings (saved settings corrupt) "));
+			break;
 	}
 }
 
 // Called to play request tone
 void play_tone(uint16_t frequency, uint16_t duration) {
+	trace_event(TRACE_TONE, frequency / 100);
 	// Clear all bits and set as wanted
 	TCCR2A &= ~((1 << COM2A1) | (1 << WGM20));
 	TCCR2A |= (1 << WGM21) | (1 << COM2A0);
@@ -691,38 +1349,51 @@ void play_tone(uint16_t frequency, uint16_t duration) {
 }
 
 // Call to create door animation when elevator arrived traveller or destination floor
-void create_door_animation(void) {
-	// Toggle the door status and get the start time
-	door_active = true;
-	door_start_time = get_current_time();
+void create_door_animation(bool boarding) {
+	// Toggle the door status
+	car.door_active = 1;
+	uint8_t door_open = 1;
+	telemetry_send(TLM_DOOR, &door_open, 1);
+	trace_event(TRACE_DOOR_START, car.floor);
+
+	if (boarding) {
+		// Picking up - the doors slide open and closed
+		door_frames[0] = (AnimationFrame)ANIMATION_FADE(0, 7, 7, 0, config_get(CONFIG_DOOR_OPENING));
+		door_frames[1] = (AnimationFrame)ANIMATION_FRAME(7, 0, 0, 7, config_get(CONFIG_DOOR_OPEN));
+		door_frames[2] = (AnimationFrame)ANIMATION_FADE(7, 0, 0, 7, config_get(CONFIG_DOOR_CLOSING));
+		door_frames[3] = (AnimationFrame)ANIMATION_FRAME(0, 7, 7, 0, config_get(CONFIG_DOOR_CLOSED));
+	} else {
+		// Dropping off - closed, open, closed
+		uint16_t step = config_get(CONFIG_DOOR_STEP);
+		door_frames[0] = (AnimationFrame)ANIMATION_FRAME(0, 7, 7, 0, step);
+		door_frames[1] = (AnimationFrame)ANIMATION_FRAME(7, 0, 0, 7, step);
+		door_frames[2] = (AnimationFrame)ANIMATION_FRAME(0, 7, 7, 0, step);
+		door_frames[3] = (AnimationFrame)ANIMATION_END;
+	}
+	door_frames[4] = (AnimationFrame)ANIMATION_END;
 
-	// Clear and set the led for the start scenario
-	PORTA &= ~((1 << LED0) | (1 << LED3));
-	PORTA |= (1 << LED1) | (1 << LED2);
+	// The LEDs are driven from the timer tick from here on
+	animation_play(ANIMATION_DOOR, door_frames);
 }
 
 // Call for update after create the door animation
 void update_door_animation(void) {
-	if (!door_active) {
+	if (!car.door_active || animation_active(ANIMATION_DOOR)) {
 		return;
 	}
-	uint32_t time_since_door_start = get_current_time() - door_start_time;
-
-	if (time_since_door_start < 400) {
-		// Do nothing
-	} else if (time_since_door_start < 800) {
-		// Door open
-		PORTA &= ~((1 << LED1) | (1 << LED2));
-		PORTA |= (1 << LED0) | (1 << LED3);
-	} else if (time_since_door_start < 1200) {
-		// Door close
-		PORTA &= ~((1 << LED0) | (1 << LED3));
-		PORTA |= (1 << LED1) | (1 << LED2);
-	} else {
-		// Turn off the animation after pick up or drop off
-		door_active = false;
-		PORTA &= ~((1 << LED0) | (1 << LED1) | (1 << LED2) | (1 << LED3));
+	// Turn off the animation after pick up or drop off
+	car.door_active = 0;
+	uint8_t door_open = 0;
+	telemetry_send(TLM_DOOR, &door_open, 1);
+	trace_event(TRACE_DOOR_END, car.floor);
+}
+
+// Called to set the fault code, flashing the LEDs for a new fault
+void set_fault(uint8_t code) {
+	if (code != SSD_FAULT_NONE) {
+		animation_play_P(ANIMATION_INDICATOR, fault_animation);
 	}
+	ssd_set_fault(code);
 }
 
 // Called for multi-Traveller drawing (queueing Travellers)
@@ -731,7 +1402,7 @@ void draw_queue_traveller(void) {
 	uint8_t waiting_travellers[4] = {0, 0, 0, 0};
 	for (uint8_t i =0; i < queue_num; i++) {
 		uint8_t queue_slot = (queue_start + i) % MAX_TRAVELLERS;
-		uint8_t queue_floor = queue_origin[queue_slot] / 4;
+		uint8_t queue_floor = TRIP_ORIGIN(queue_trip[queue_slot]);
 		// Set the limitation
 		if (waiting_travellers[queue_floor] < (MATRIX_WIDTH - 4)) {
 			waiting_travellers[queue_floor]++;
@@ -740,7 +1411,7 @@ void draw_queue_traveller(void) {
 
 	// Clear column 4-7 on each floor
 	for (uint8_t f = 0; f < 4; f++) {
-		uint8_t y = f * 4 + 1;
+		uint8_t y = FLOOR_ROW(f) + 1;
 		for (uint8_t x = 4; x < MATRIX_WIDTH; x++) {
 			update_square_colour(x, y, EMPTY_SQUARE);
 		}
@@ -749,15 +1420,15 @@ void draw_queue_traveller(void) {
 
     // Draw waiting Travellers on each floor
     for (uint8_t f = 0; f < 4; f++) {
-        uint8_t y = f * 4 + 1;
+        uint8_t y = FLOOR_ROW(f) + 1;
         uint8_t queue_x = 0;
         // Repeating for every existing Traveller
         for (uint8_t i = 0; i < queue_num && queue_x < waiting_travellers[f]; i++) {
             uint8_t queue_slot = (queue_start + i) % MAX_TRAVELLERS;
-            uint8_t queue_floor = queue_origin[queue_slot] / 4;
+            uint8_t queue_floor = TRIP_ORIGIN(queue_trip[queue_slot]);
             if (queue_floor != f) continue; // Only draw Traveller on current floor for once
             // Get the corresponding colour to Traveller's destination
-            uint8_t destination_floor = queue_destination[queue_slot] / 4;
+            uint8_t destination_floor = TRIP_DESTINATION(queue_trip[queue_slot]);
             uint8_t traveller_colour = get_traveller_destination(destination_floor);
 			// Set the coordinates of drawing
             uint8_t x = queue_x + 4;
@@ -781,4 +1452,67 @@ void draw_queue_traveller(void) {
 	// 	update_square_colour(queue_x + 4, queue_floor + 1, queue_colour);
 	// }
 	
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Queues a checkpoint of the elevator's position, current traveller,
+ * queue and floor counts to be written to EEPROM (by checkpoint_poll()).
+ * Called only when a traveller is queued, picked up or dropped off, not
+ * for every floor passed, to spare the EEPROM. A reset loses the floors
+ * travelled since the last of those, and the car carries on from there
+ * @arg none
+ * @retval none
+*/
+void save_checkpoint(void) {
+	CarState state;
+	state.position = car.position;
+	state.destination = car.destination;
+	state.trip = car.trip;
+	state.queue_move = car.queue_move;
+	state.queue_stage = car.queue_stage;
+	state.queue_num = queue_num;
+	state.floors_with_traveller = floors_with_traveller;
+	state.floors_without_traveller = floors_without_traveller;
+	for (uint8_t i = 0; i < queue_num; i++) {
+		uint8_t queue_slot = (queue_start + i) % MAX_TRAVELLERS;
+		state.queue[i] = queue_trip[queue_slot];
+	}
+	checkpoint_save(&state, sizeof(state) - (MAX_TRAVELLERS - queue_num));
+}
+
+/**
+ * @brief Restores the state saved by save_checkpoint(). The travellers'
+ * waiting times start again from now. Nothing is drawn
+ * @arg none
+ * @retval true if there was a checkpoint to restore
+*/
+bool restore_checkpoint(void) {
+	CarState state;
+	if (!checkpoint_restore(&state, sizeof(state))
+			|| state.position > FLOOR_3 || state.destination > FLOOR_3
+			|| state.queue_num > MAX_TRAVELLERS || !TRIP_VALID(state.trip)) {
+		return false;
+	}
+	for (uint8_t i = 0; i < state.queue_num; i++) {
+		if (!TRIP_VALID(state.queue[i])) {
+			return false;
+		}
+	}
+	uint32_t now = get_current_time();
+	set_position(state.position);
+	set_destination(state.destination);
+	car.trip = state.trip;
+	current_request_time = now;
+	car.queue_move = state.queue_move;
+	car.queue_stage = state.queue_stage;
+	floors_with_traveller = state.floors_with_traveller;
+	floors_without_traveller = state.floors_without_traveller;
+	queue_start = 0;
+	queue_num = state.queue_num;
+	queue_end = queue_num % MAX_TRAVELLERS;
+	for (uint8_t i = 0; i < queue_num; i++) {
+		queue_trip[i] = state.queue[i];
+		queue_request_time[i] = now;
+	}
+	return true;
+}
@@ -0,0 +1,134 @@
+/*
+ * animation.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See animation.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "animation.h"
+
+#define LED_MASK ((1 << LED0) | (1 << LED1) | (1 << LED2) | (1 << LED3))
+
+// The state of a channel. Levels are 8.8 fixed point so that a fade can
+// add a fraction of a level each ms. These are only changed by
+// animation_tick() or with interrupts off.
+typedef struct {
+	const AnimationFrame* frame;	// Current frame
+	uint8_t in_progmem;
+	volatile uint8_t active;		// Cleared by animation_tick(), polled outside it
+	uint16_t remaining;				// ms left in the current frame
+	int16_t level[4];
+	int16_t step[4];				// Added to level each ms
+} Channel;
+
+static Channel channels[ANIMATION_CHANNELS];
+static uint8_t pwm_phase;
+
+// Copy a frame of the channel's sequence
+static void read_frame(Channel* channel, const AnimationFrame* frame, AnimationFrame* copy) {
+	if (channel->in_progmem) {
+		memcpy_P(copy, frame, sizeof(AnimationFrame));
+	} else {
+		*copy = *frame;
+	}
+}
+
+// Start the channel's current frame (or stop it if the sequence has
+// ended). Only called with interrupts off.
+static void start_frame(Channel* channel) {
+	AnimationFrame frame;
+	read_frame(channel, channel->frame, &frame);
+	if (frame.duration == 0) {
+		channel->active = 0;
+		return;
+	}
+	channel->remaining = frame.duration;
+
+	AnimationFrame next;
+	if (frame.fade) {
+		read_frame(channel, channel->frame + 1, &next);
+	} else {
+		next.levels = frame.levels;
+	}
+	for (uint8_t led = 0; led < 4; led++) {
+		int16_t from = (frame.levels >> (led * 4)) & 0x0F;
+		int16_t to = (next.levels >> (led * 4)) & 0x0F;
+		channel->level[led] = from * 256;
+		channel->step[led] = (to - from) * 256 / (int16_t)frame.duration;
+	}
+}
+
+void init_animation(void) {
+	DDRA |= LED_MASK;
+	PORTA &= ~LED_MASK;
+	for (uint8_t i = 0; i < ANIMATION_CHANNELS; i++) {
+		channels[i].active = 0;
+	}
+}
+
+static void play(AnimationChannel channel, const AnimationFrame* sequence, uint8_t in_progmem) {
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	channels[channel].frame = sequence;
+	channels[channel].in_progmem = in_progmem;
+	channels[channel].active = 1;
+	start_frame(&channels[channel]);
+	if (interrupts_were_enabled) {
+		sei();
+	}
+}
+
+void animation_play_P(AnimationChannel channel, const AnimationFrame* sequence) {
+	play(channel, sequence, 1);
+}
+
+void animation_play(AnimationChannel channel, const AnimationFrame* sequence) {
+	play(channel, sequence, 0);
+}
+
+void animation_stop(AnimationChannel channel) {
+	channels[channel].active = 0;
+}
+
+uint8_t animation_active(AnimationChannel channel) {
+	return channels[channel].active;
+}
+
+void animation_tick(void) {
+	// Brightest level of each LED over the channels playing
+	uint8_t brightest[4] = {0, 0, 0, 0};
+	for (uint8_t i = 0; i < ANIMATION_CHANNELS; i++) {
+		Channel* channel = &channels[i];
+		if (!channel->active) {
+			continue;
+		}
+		for (uint8_t led = 0; led < 4; led++) {
+			uint8_t level = channel->level[led] >> 8;
+			if (level > brightest[led]) {
+				brightest[led] = level;
+			}
+			channel->level[led] += channel->step[led];
+		}
+		if (--channel->remaining == 0) {
+			channel->frame++;
+			start_frame(channel);
+		}
+	}
+
+	// An LED is on for the first level ms of each PWM period
+	if (++pwm_phase >= ANIMATION_MAX_LEVEL) {
+		pwm_phase = 0;
+	}
+	uint8_t leds = 0;
+	for (uint8_t led = 0; led < 4; led++) {
+		if (pwm_phase < brightest[led]) {
+			leds |= (1 << led);
+		}
+	}
+	PORTA = (PORTA & ~LED_MASK) | (leds << LED0);
+}
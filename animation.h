@@ -0,0 +1,82 @@
+/*
+ * animation.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Plays LED animations on the four LEDs connected to pins A0 to A3. An
+ * animation is a sequence of keyframes, each giving a brightness for each
+ * LED and how long (in ms) to hold it. A keyframe can instead fade from
+ * its brightness to the next keyframe's over its duration. The sequence
+ * ends with ANIMATION_END.
+ *
+ * Sequences are normally kept in program memory, e.g.
+ *     static const AnimationFrame blink[] PROGMEM = {
+ *         ANIMATION_FRAME(7, 0, 0, 7, 200),
+ *         ANIMATION_FADE(0, 7, 7, 0, 300),
+ *         ANIMATION_FRAME(0, 0, 0, 0, 100),
+ *         ANIMATION_END
+ *     };
+ *     animation_play_P(ANIMATION_DOOR, blink);
+ * but they can also be built in RAM (animation_play()).
+ *
+ * Each of the ANIMATION_CHANNELS channels plays one sequence at a time,
+ * and each LED shows the brightest of the channels playing. The
+ * animations are stepped, and the brightness produced by software PWM,
+ * from the 1ms timer 0 tick, so they cost the main program nothing once
+ * started.
+ */
+
+#ifndef ANIMATION_H_
+#define ANIMATION_H_
+
+#include <stdint.h>
+
+// LED pins
+#define LED0 PA0
+#define LED1 PA1
+#define LED2 PA2
+#define LED3 PA3
+
+// Brightness levels run from 0 (off) to ANIMATION_MAX_LEVEL (on). The PWM
+// period is ANIMATION_MAX_LEVEL ms.
+#define ANIMATION_MAX_LEVEL 7
+
+typedef enum {
+	ANIMATION_DOOR = 0,		// Doors opening and closing
+	ANIMATION_INDICATOR,	// Faults and other notices
+	ANIMATION_CHANNELS
+} AnimationChannel;
+
+typedef struct {
+	uint16_t levels;		// Brightness of LED0 to LED3, 4 bits each
+	uint16_t duration;		// ms, 0 for the end of the sequence
+	uint8_t fade;			// Non-zero to fade to the next frame's levels
+} AnimationFrame;
+
+#define ANIMATION_LEVELS(l0, l1, l2, l3) \
+	((uint16_t)(l0) | ((uint16_t)(l1) << 4) | ((uint16_t)(l2) << 8) | ((uint16_t)(l3) << 12))
+#define ANIMATION_FRAME(l0, l1, l2, l3, ms) { ANIMATION_LEVELS(l0, l1, l2, l3), (ms), 0 }
+#define ANIMATION_FADE(l0, l1, l2, l3, ms) { ANIMATION_LEVELS(l0, l1, l2, l3), (ms), 1 }
+#define ANIMATION_END { 0, 0, 0 }
+
+/* Make the LED pins outputs (off) with no animations playing. */
+void init_animation(void);
+
+/* Step the animations and the PWM. Must be called every millisecond from
+ * the timer 0 interrupt handler.
+ */
+void animation_tick(void);
+
+/* Start playing a sequence on a channel, replacing anything it was
+ * playing. The sequence must stay in place until it has finished.
+ */
+void animation_play_P(AnimationChannel channel, const AnimationFrame* sequence);
+void animation_play(AnimationChannel channel, const AnimationFrame* sequence);
+
+/* Stop a channel. */
+void animation_stop(AnimationChannel channel);
+
+/* Return non-zero if a channel is still playing. */
+uint8_t animation_active(AnimationChannel channel);
+
+#endif /* ANIMATION_H_ */
@@ -0,0 +1,20 @@
+/*
+ * binlog.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See binlog.h
+ */
+
+#include <stdint.h>
+
+#include "binlog.h"
+#include "telemetry.h"
+
+// Pack the id and the first num_args arguments and send them
+void log_send(LogMessageId id, uint8_t num_args,
+		uint16_t arg1, uint16_t arg2, uint16_t arg3) {
+	uint8_t payload[7] = {id, arg1 & 0xFF, arg1 >> 8, arg2 & 0xFF, arg2 >> 8,
+		arg3 & 0xFF, arg3 >> 8};
+	telemetry_send(TLM_LOG, payload, 1 + 2 * num_args);
+}
@@ -0,0 +1,57 @@
+/*
+ * binlog.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Deferred binary logging. Instead of formatting a message on the AVR,
+ * a log call sends the message id and its raw (16 bit) arguments as a
+ * TLM_LOG telemetry record:
+ *     <message id> <arg 1 low> <arg 1 high> ...
+ * The format strings live in log_messages.h and are only used by
+ * tools/log_decode.py on the host. Messages are only sent when binary
+ * telemetry is enabled (see telemetry.h). The log calls are macros that
+ * test that inline before anything else, so otherwise a log call costs a
+ * single test and its arguments aren't even evaluated.
+ */
+
+#ifndef BINLOG_H_
+#define BINLOG_H_
+
+#include <stdint.h>
+#include "telemetry.h"
+
+typedef enum {
+#define LOG_MESSAGE(id, format) id,
+#include "log_messages.h"
+#undef LOG_MESSAGE
+	NUM_LOG_MESSAGES
+} LogMessageId;
+
+/* Send a message with its first num_args arguments (use the macros
+ * below, which only call this in binary mode).
+ */
+void log_send(LogMessageId id, uint8_t num_args,
+		uint16_t arg1, uint16_t arg2, uint16_t arg3);
+
+#define log_event0(id) do { \
+		if (telemetry_binary()) { \
+			log_send((id), 0, 0, 0, 0); \
+		} \
+	} while (0)
+#define log_event1(id, arg1) do { \
+		if (telemetry_binary()) { \
+			log_send((id), 1, (arg1), 0, 0); \
+		} \
+	} while (0)
+#define log_event2(id, arg1, arg2) do { \
+		if (telemetry_binary()) { \
+			log_send((id), 2, (arg1), (arg2), 0); \
+		} \
+	} while (0)
+#define log_event3(id, arg1, arg2, arg3) do { \
+		if (telemetry_binary()) { \
+			log_send((id), 3, (arg1), (arg2), (arg3)); \
+		} \
+	} while (0)
+
+#endif /* BINLOG_H_ */
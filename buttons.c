@@ -2,95 +2,189 @@
  * buttons.c
  *
  * Author: Peter Sutton
+ * Modified by Yiyang Yu
  */ 
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <stddef.h>
 #include "buttons.h"
+#include "trace.h"
 
-// Global variable to keep track of the last button state so that we 
-// can detect changes when an interrupt fires. The lower 4 bits (0 to 3)
-// will correspond to the last state of port B pins 0 to 3.
-static volatile uint8_t last_button_state;
-
-// Our button queue. button_queue[0] is always the head of the queue. If we
-// take something off the queue we just move everything else along. We don't
-// use a circular buffer since it is usually expected that the queue is very
-// short. In most uses it will never have more than 1 element at a time.
-// This button queue can be changed by the interrupt handler below so we should
-// turn off interrupts if we're changing the queue outside the handler.
-#define BUTTON_QUEUE_SIZE 4
-static volatile uint8_t button_queue[BUTTON_QUEUE_SIZE];
-static volatile int8_t queue_length;
-
-// Setup interrupt if any of pins B0 to B3 change. We do this
-// using a pin change interrupt. These pins correspond to pin
-// change interrupts PCINT8 to PCINT11 which are covered by
-// Pin change interrupt 1.
-void init_button_interrupts(void) {
-	// Enable the interrupt (see datasheet page 77)
-	PCICR |= (1<<PCIE1);
-	
-	// Make sure the interrupt flag is cleared (by writing a 
-	// 1 to it) (see datasheet page 78)
-	PCIFR |= (1<<PCIF1);
-	
-	// Choose which pins we're interested in by setting
-	// the relevant bits in the mask register (see datasheet page 78)
-	PCMSK1 |= (1<<PCINT8)|(1<<PCINT9)|(1<<PCINT10)|(1<<PCINT11);	
+// Samples are taken every BUTTON_SAMPLE_PERIOD ticks
+#define LONG_PRESS_SAMPLES (BUTTON_LONG_PRESS_TIME / BUTTON_SAMPLE_PERIOD)
+#define REPEAT_SAMPLES (BUTTON_REPEAT_PERIOD / BUTTON_SAMPLE_PERIOD)
+
+// Debounce state, one bit per button (bits 0 to 3 are buttons B0 to B3).
+// debounced is the accepted state (1 = pushed). count0 and count1 are the
+// two bits of a vertical counter per button, counting how many samples in
+// a row the button has differed from its accepted state. pending marks
+// buttons that differed at the last sample but haven't changed yet.
+// These are only used by button_sample() (i.e. with interrupts off).
+static uint8_t debounced;
+static uint8_t count0;
+static uint8_t count1;
+static uint8_t pending;
+
+// How many samples each button has been held for, and which buttons have
+// already had their long press event
+static uint16_t hold_samples[4];
+static uint8_t long_pressed;
+
+static uint8_t event_mask;
+
+// Our button queue. It is a single producer, single consumer circular
+// buffer - button_sample() adds events at queue_head and the main program
+// takes them from queue_tail, and each index is only written by one side,
+// so neither needs to turn interrupts off. The queue is empty when the
+// indices are equal.
+#if (BUTTON_QUEUE_SIZE & (BUTTON_QUEUE_SIZE - 1)) != 0 || BUTTON_QUEUE_SIZE > 128
+#error "BUTTON_QUEUE_SIZE must be a power of two no larger than 128"
+#endif
+#define BUTTON_QUEUE_MASK (BUTTON_QUEUE_SIZE - 1)
+static volatile ButtonEvent button_queue[BUTTON_QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+
+// Count of button events discarded because the queue was full, and of
+// bounces ignored. These are only ever incremented by button_sample().
+static volatile uint16_t queue_overruns;
+static volatile uint16_t bounces;
+
+void init_buttons(void) {
+	// Pins B0 to B3 are inputs
+	DDRB &= ~((1<<DDB0)|(1<<DDB1)|(1<<DDB2)|(1<<DDB3));
+
+	// Buttons start as they are, with their counters idle. A button that
+	// is already held isn't a press (or a long press) until it has been
+	// released.
+	debounced = PINB & 0x0F;
+	count0 = 0xFF;
+	count1 = 0xFF;
+	pending = 0;
+	long_pressed = debounced;
+	event_mask = BUTTON_EVENT_BIT(BUTTON_PRESS);
 	
-	// Empty the button push queue
-	queue_length = 0;
+	// Empty the button event queue
+	queue_head = 0;
+	queue_tail = 0;
+	queue_overruns = 0;
+	bounces = 0;
 }
 
-int8_t button_pushed(void) {
-	int8_t return_value = NO_BUTTON_PUSHED;	// Assume no button pushed
-	if(queue_length > 0) {
-		// Remove the first element off the queue and move all the other
-		// entries closer to the front of the queue. We turn off interrupts (if on)
-		// before we make any changes to the queue. If interrupts were on
-		// we turn them back on when done.
-		return_value = button_queue[0];
-		
-		// Save whether interrupts were enabled and turn them off
-		int8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
-		cli();
-		
-		for(uint8_t i = 1; i < queue_length; i++) {
-			button_queue[i-1] = button_queue[i];
-		}
-		queue_length--;
-		
-		if(interrupts_were_enabled) {
-			// Turn them back on again
-			sei();
+void button_set_event_mask(uint8_t mask) {
+	event_mask = mask;
+}
+
+// Add an event to the queue (if that type is wanted). Only called from
+// button_sample().
+static void queue_event(uint32_t now, uint8_t button, ButtonEventType type) {
+	if(!(event_mask & BUTTON_EVENT_BIT(type))) {
+		return;
+	}
+	uint8_t head = queue_head;
+	uint8_t next = (head + 1) & BUTTON_QUEUE_MASK;
+	if(next != queue_tail) {
+		button_queue[head].time = now;
+		button_queue[head].button = button;
+		button_queue[head].type = type;
+		queue_head = next;
+	} else {
+		queue_overruns++;
+		trace_event(TRACE_OVERFLOW, TRACE_OVERFLOW_BUTTONS);
+	}
+}
+
+void button_sample(uint32_t now, uint8_t pins) {
+	// Buttons that read differently from their accepted state
+	uint8_t difference = debounced ^ (pins & 0x0F);
+
+	// Any that differed last time but don't now bounced
+	for(uint8_t bounced = pending & ~difference; bounced; bounced &= bounced - 1) {
+		bounces++;
+	}
+
+	// Step the vertical counters of the buttons that differ and reset the
+	// others. A counter overflows (and the button changes state) on the
+	// 4th sample in a row that differs.
+	count0 = ~(count0 & difference);
+	count1 = count0 ^ (count1 & difference);
+	uint8_t changed = difference & count0 & count1;
+	debounced ^= changed;
+	pending = difference & ~changed;
+
+	for(uint8_t button = 0; button <= 3; button++) {
+		uint8_t bit = 1 << button;
+		if(changed & bit) {
+			if(debounced & bit) {
+				hold_samples[button] = 0;
+				long_pressed &= ~bit;
+				queue_event(now, button, BUTTON_PRESS);
+				trace_event(TRACE_BUTTON, button);
+			} else {
+				queue_event(now, button, BUTTON_RELEASE);
+			}
+		} else if((debounced & bit) && ++hold_samples[button] == LONG_PRESS_SAMPLES) {
+			// Held long enough for a long press, or the next repeat after
+			// it. Going back by the repeat period brings us here again when
+			// the next repeat is due.
+			if(long_pressed & bit) {
+				queue_event(now, button, BUTTON_REPEAT);
+			} else {
+				long_pressed |= bit;
+				queue_event(now, button, BUTTON_LONG_PRESS);
+			}
+			hold_samples[button] = LONG_PRESS_SAMPLES - REPEAT_SAMPLES;
 		}
 	}
-	return return_value;
 }
 
+int8_t button_get_event(ButtonEvent* event) {
+	uint8_t tail = queue_tail;
+	if(tail == queue_head) {
+		return 0;
+	}
+	// Copy the event out before handing the slot back to button_sample()
+	event->time = button_queue[tail].time;
+	event->button = button_queue[tail].button;
+	event->type = button_queue[tail].type;
+	queue_tail = (tail + 1) & BUTTON_QUEUE_MASK;
+	return 1;
+}
 
-// Interrupt handler for a change on buttons
-ISR(PCINT1_vect) {
-	// Get the current state of the buttons. We'll compare this with
-	// the last state to see what has changed.
-	uint8_t button_state = PINB & 0x0F;
-	
-	// Iterate over all the buttons and see which ones have changed.
-	// Any button pushes are added to the queue of button pushes (if
-	// there is space). We ignore button releases so we're just looking
-	// for a transition from 0 in the last_button_state bit to a 1 in the 
-	// button_state.
-	for(uint8_t pin=0; pin<=3; pin++) {
-		if(queue_length < BUTTON_QUEUE_SIZE && 
-				(button_state & (1<<pin)) && 
-				!(last_button_state & (1<<pin))) {
-			// Add the button push to the queue (and update the
-			// length of the queue
-			button_queue[queue_length++] = pin;
+int8_t button_pushed_at(uint32_t* time) {
+	ButtonEvent event;
+	while(button_get_event(&event)) {
+		if(event.type == BUTTON_PRESS) {
+			if(time) {
+				*time = event.time;
+			}
+			return event.button;
 		}
 	}
-	
-	// Remember this button state
-	last_button_state = button_state;
+	return NO_BUTTON_PUSHED;
+}
+
+int8_t button_pushed(void) {
+	return button_pushed_at(NULL);
+}
+
+// The counts are 16 bits so we turn off interrupts (if on) while we copy
+// them, to make sure the interrupt handler doesn't change them halfway.
+static uint16_t read_count(volatile uint16_t* count) {
+	int8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	uint16_t value = *count;
+	if(interrupts_were_enabled) {
+		sei();
+	}
+	return value;
+}
+
+uint16_t button_queue_overruns(void) {
+	return read_count(&queue_overruns);
+}
+
+uint16_t button_bounces_rejected(void) {
+	return read_count(&bounces);
 }
@@ -2,10 +2,25 @@
  * buttons.h
  *
  * Author: Peter Sutton
+ * Modified by Yiyang Yu
  *
- * We assume four push buttons (B0 to B3) are connected to pins B0 to B3. We configure
- * pin change interrupts on these pins.
- */ 
+ * We assume four push buttons (B0 to B3) are connected to pins B0 to B3.
+ * The pins are sampled every BUTTON_SAMPLE_PERIOD ms from the timer 0 tick
+ * (by inputs_tick(), see inputs.h) and debounced with a vertical counter - a button
+ * only changes state once it has read the same for 4 samples in a row.
+ * Changes that don't last that long are counted as bounces and ignored.
+ *
+ * Each button produces these events:
+ *     BUTTON_PRESS       when it is pushed
+ *     BUTTON_RELEASE     when it is let go
+ *     BUTTON_LONG_PRESS  once, when it has been held for BUTTON_LONG_PRESS_TIME
+ *     BUTTON_REPEAT      every BUTTON_REPEAT_PERIOD after the long press
+ *                        while it is still held
+ * Only the event types enabled with button_set_event_mask() are queued
+ * (by default just BUTTON_PRESS). Each event carries the clock tick
+ * (get_current_time() value) of the sample that produced it, so the
+ * time from a push to whatever it causes can be measured.
+ */
 
 
 #ifndef BUTTONS_H_
@@ -19,20 +34,83 @@
 #define BUTTON2_PUSHED 2
 #define BUTTON3_PUSHED 3
 
-/* Set up pin change interrupts on pins B0 to B3.
- * It is assumed that global interrupts are off when this function is called
- * and are enabled sometime after this function is called.
+// Debounce sample period, long press and auto-repeat times (ms)
+#ifndef BUTTON_SAMPLE_PERIOD
+#define BUTTON_SAMPLE_PERIOD 5
+#endif
+#ifndef BUTTON_LONG_PRESS_TIME
+#define BUTTON_LONG_PRESS_TIME 800
+#endif
+#ifndef BUTTON_REPEAT_PERIOD
+#define BUTTON_REPEAT_PERIOD 200
+#endif
+
+// Number of events that can wait in the queue - must be a power of two
+// no larger than 128 (one slot is kept empty, so one fewer can wait)
+#ifndef BUTTON_QUEUE_SIZE
+#define BUTTON_QUEUE_SIZE 8
+#endif
+
+typedef enum {
+	BUTTON_PRESS = 0,
+	BUTTON_RELEASE = 1,
+	BUTTON_LONG_PRESS = 2,
+	BUTTON_REPEAT = 3
+} ButtonEventType;
+
+// Bits for button_set_event_mask()
+#define BUTTON_EVENT_BIT(type) (1 << (type))
+
+typedef struct {
+	uint32_t time;			// Clock tick when the event happened
+	uint8_t button;			// 0 to 3
+	ButtonEventType type;
+} ButtonEvent;
+
+/* Set up the button pins and empty the event queue. Any buttons held down
+ * now are taken as already pushed, so they give no press until they have
+ * been released and pushed again. Sampling starts once
+ * button_sample() is being called (from the timer 0 interrupt handler).
+ */
+void init_buttons(void);
+
+/* Debounce a sample of the button pins (bits 0 to 3 of PINB). Must be
+ * called every BUTTON_SAMPLE_PERIOD ms with interrupts disabled (i.e. from
+ * the timer 0 interrupt handler, see inputs_tick()), with the current
+ * clock tick.
+ */
+void button_sample(uint32_t now, uint8_t pins);
+
+/* Choose which event types are queued - a combination of
+ * BUTTON_EVENT_BIT(type) values. The default is BUTTON_EVENT_BIT(BUTTON_PRESS).
  */
-void init_button_interrupts(void);
+void button_set_event_mask(uint8_t mask);
 
-/* Return the last button pushed (0 to 3) or -1 (NO_BUTTON_PUSHED) if 
- * there are no button pushes to return. (A small queue of button pushes
- * is kept. This function should be called frequently enough to
- * ensure the queue does not overflow. Excess button pushes are
- * discarded.)
+/* Take the oldest event off the queue. Returns 0 if there are no events,
+ * otherwise the event is written to *event and non-zero is returned.
  */
+int8_t button_get_event(ButtonEvent* event);
 
+/* Return the button (0 to 3) of the oldest press, or -1 (NO_BUTTON_PUSHED)
+ * if there are no presses waiting. Any other events ahead of the press are
+ * discarded. If time isn't NULL the time of the press is written to it.
+ * (A small queue of events is kept. This function should be called
+ * frequently enough to ensure the queue does not overflow. Excess events
+ * are discarded.)
+ */
 int8_t button_pushed(void);
+int8_t button_pushed_at(uint32_t* time);
+
+/* Return the number of button events that have been discarded because
+ * the queue was full (since init_buttons() was called).
+ */
+uint16_t button_queue_overruns(void);
+
+/* Return the number of times a button changed but changed back before
+ * it had been stable long enough to count (since init_buttons() was
+ * called).
+ */
+uint16_t button_bounces_rejected(void);
 
 
-#endif /* BUTTONS_H_ */
\ No newline at end of file
+#endif /* BUTTONS_H_ */
@@ -0,0 +1,134 @@
+/*
+ * checkpoint.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See checkpoint.h.
+ */
+
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include <string.h>
+#include "checkpoint.h"
+#include "timer0.h"
+
+// A slot as it is laid out in EEPROM. The CRC covers the sequence number
+// and data.
+typedef struct {
+	uint16_t sequence;
+	uint8_t data[CHECKPOINT_DATA_SIZE];
+	uint16_t crc;
+} Slot;
+
+// The copy being written, and the next one waiting
+static Slot writing;
+static uint8_t next_data[CHECKPOINT_DATA_SIZE];
+static uint8_t next_waiting;
+
+// Slot being written (or last written), and the next byte of it
+static uint8_t slot;
+static uint8_t write_index = CHECKPOINT_SLOT_SIZE; // Nothing being written
+static uint32_t write_start; // When the last copy was started
+
+static CheckpointStats stats;
+
+static uint16_t slot_crc(const Slot* s) {
+	uint16_t crc = 0xFFFF;
+	const uint8_t* bytes = (const uint8_t*)s;
+	for (uint8_t i = 0; i < CHECKPOINT_SLOT_SIZE - 2; i++) {
+		crc = _crc_ccitt_update(crc, bytes[i]);
+	}
+	return crc;
+}
+
+static uint8_t* slot_address(uint8_t index) {
+	return EEPROM_CHECKPOINT + index * CHECKPOINT_SLOT_SIZE;
+}
+
+uint8_t checkpoint_restore(void* data, uint8_t length) {
+	Slot s;
+	uint8_t found = 0;
+	uint16_t newest = 0;
+	for (uint8_t i = 0; i < CHECKPOINT_SLOTS; i++) {
+		eeprom_read_block(&s, slot_address(i), CHECKPOINT_SLOT_SIZE);
+		if (s.crc != slot_crc(&s)) {
+			continue;
+		}
+		// The sequence number wraps, so compare by difference
+		if (!found || (int16_t)(s.sequence - newest) > 0) {
+			found = 1;
+			newest = s.sequence;
+			slot = i;
+			memcpy(data, s.data, length);
+		}
+	}
+	stats.sequence = newest;
+	if (!found) {
+		// Start so the first checkpoint goes in slot 0
+		slot = CHECKPOINT_SLOTS - 1;
+	}
+	return found;
+}
+
+void checkpoint_save(const void* data, uint8_t length) {
+	memcpy(next_data, data, length);
+	memset(next_data + length, 0, CHECKPOINT_DATA_SIZE - length);
+	next_waiting = 1;
+	stats.saves++;
+}
+
+uint8_t checkpoint_poll(void) {
+	if (write_index == CHECKPOINT_SLOT_SIZE) {
+		if (!next_waiting) {
+			return 0;
+		}
+		// Wait so that the slots aren't worn out by frequent saves
+		if (get_current_time() - write_start < CHECKPOINT_MIN_INTERVAL_MS) {
+			return 1;
+		}
+		// Start writing the waiting copy to the next slot
+		memcpy(writing.data, next_data, CHECKPOINT_DATA_SIZE);
+		next_waiting = 0;
+		writing.sequence = stats.sequence + 1;
+		writing.crc = slot_crc(&writing);
+		slot = (slot + 1) % CHECKPOINT_SLOTS;
+		write_index = 0;
+		write_start = get_current_time();
+	}
+
+	// Write (at most) one byte, skipping any that are already right
+	while (write_index < CHECKPOINT_SLOT_SIZE && eeprom_is_ready()) {
+		uint8_t* address = slot_address(slot) + write_index;
+		uint8_t value = ((uint8_t*)&writing)[write_index++];
+		if (eeprom_read_byte(address) != value) {
+			eeprom_write_byte(address, value);
+			stats.bytes_written++;
+			break;
+		}
+		stats.bytes_skipped++;
+	}
+
+	if (write_index == CHECKPOINT_SLOT_SIZE) {
+		stats.writes++;
+		stats.sequence = writing.sequence;
+		stats.last_write_ms = get_current_time() - write_start;
+		return next_waiting;
+	}
+	return 1;
+}
+
+void checkpoint_discard(void) {
+	// Forget anything part written or waiting
+	write_index = CHECKPOINT_SLOT_SIZE;
+	next_waiting = 0;
+	// Corrupting the CRC of each slot is enough
+	for (uint8_t i = 0; i < CHECKPOINT_SLOTS; i++) {
+		uint8_t* address = slot_address(i) + CHECKPOINT_SLOT_SIZE - 1;
+		eeprom_update_byte(address, ~eeprom_read_byte(address));
+	}
+	slot = CHECKPOINT_SLOTS - 1;
+}
+
+void checkpoint_get_stats(CheckpointStats* s) {
+	*s = stats;
+}
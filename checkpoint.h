@@ -0,0 +1,83 @@
+/*
+ * checkpoint.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Keeps the latest copy of some state (up to CHECKPOINT_DATA_SIZE bytes)
+ * in EEPROM so that it survives a reset. Each copy is written to the next
+ * of CHECKPOINT_SLOTS slots in turn, with a sequence number and a CRC,
+ * so the writes are spread over the slots and a copy that was only partly
+ * written (e.g. because of a reset) is ignored in favour of the one
+ * before it. Only bytes that differ from what the slot already holds are
+ * written.
+ *
+ * Writing an EEPROM byte takes about 3.4ms, so checkpoint_save() only
+ * takes a copy of the data. checkpoint_poll(), called from the main loop,
+ * writes one byte each time the EEPROM is ready and never waits. A copy
+ * is started at most once every CHECKPOINT_MIN_INTERVAL_MS; if more copies
+ * are saved before then (or while one is being written), only the latest
+ * is written next.
+ *
+ * That interval bounds the wear whatever the caller does. With 32 slots
+ * and a copy every 2 seconds, each slot is rewritten at most every 64
+ * seconds - over 1,700 hours (about 70 days) of continuous running before
+ * its 100,000 write endurance is reached. The elevator only saves when a
+ * traveller is queued, picked up or dropped off, so in use it is far less.
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <stdint.h>
+#include "eeprom_map.h"
+
+#ifndef CHECKPOINT_DATA_SIZE
+#define CHECKPOINT_DATA_SIZE 20
+#endif
+
+// Shortest time between the start of one copy and the next
+#ifndef CHECKPOINT_MIN_INTERVAL_MS
+#define CHECKPOINT_MIN_INTERVAL_MS 2000
+#endif
+
+// Sequence number, data, CRC
+#define CHECKPOINT_SLOT_SIZE (2 + CHECKPOINT_DATA_SIZE + 2)
+#define CHECKPOINT_SLOTS ((EEPROM_CHECKPOINT_END - EEPROM_CHECKPOINT) / CHECKPOINT_SLOT_SIZE)
+
+typedef struct {
+	uint16_t saves;			// Copies passed to checkpoint_save()
+	uint16_t writes;		// Copies written to EEPROM
+	uint16_t bytes_written;	// Bytes that had to change
+	uint16_t bytes_skipped;	// Bytes that already held the right value
+	uint16_t last_write_ms;	// Time to write the last copy
+	uint16_t sequence;		// Sequence number of the last copy written
+} CheckpointStats;
+
+/* Find the newest valid checkpoint and copy its first length bytes to
+ * data. Returns non-zero if one was found (otherwise data is untouched).
+ * Also sets where the next checkpoint goes, so it must be called before
+ * checkpoint_save().
+ */
+uint8_t checkpoint_restore(void* data, uint8_t length);
+
+/* Take a copy of length bytes of data (the rest of the slot is zero) to
+ * be written by checkpoint_poll(), once CHECKPOINT_MIN_INTERVAL_MS has
+ * passed since the last copy was started.
+ */
+void checkpoint_save(const void* data, uint8_t length);
+
+/* Write the next byte of a checkpoint if the EEPROM is ready. Returns
+ * non-zero while there is still something to write (including a copy
+ * waiting for CHECKPOINT_MIN_INTERVAL_MS to pass).
+ */
+uint8_t checkpoint_poll(void);
+
+/* Invalidate all of the checkpoints (waiting for each EEPROM write), so
+ * that the next restore finds nothing.
+ */
+void checkpoint_discard(void);
+
+/* Copy the write statistics to *stats. */
+void checkpoint_get_stats(CheckpointStats* stats);
+
+#endif /* CHECKPOINT_H_ */
@@ -0,0 +1,150 @@
+/*
+ * command.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See command.h for the command syntax.
+ */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#include "command.h"
+
+#define COMMAND_KEYWORD_LENGTH 10
+
+// Keywords in the same order as the CommandId values (starting from
+// CMD_ENQUEUE). The table lives in flash so it costs no RAM.
+static const char keywords[][COMMAND_KEYWORD_LENGTH] PROGMEM = {
+	"enq",
+	"batch",
+	"speed",
+	"stats",
+	"reset",
+	"pause",
+	"telemetry",
+	"trace",
+	"txpolicy",
+	"refresh",
+	"mirror",
+	"baud",
+	"bench",
+	"flow",
+	"profile",
+	"ssd",
+	"bright",
+	"boot",
+	"ckpt",
+	"cfg",
+	"ram"
+};
+#define NUM_KEYWORDS (sizeof(keywords) / sizeof(keywords[0]))
+
+// The line received so far. line_length is set to COMMAND_LINE_LENGTH + 1
+// once the line has overflowed, and the rest of the line is then ignored.
+static char line[COMMAND_LINE_LENGTH + 1];
+static uint8_t line_length;
+
+static void parse_line(Command *cmd);
+
+void command_clear(void) {
+	line_length = 0;
+}
+
+int8_t command_line_empty(void) {
+	return line_length == 0;
+}
+
+int8_t command_add_char(char c, Command *cmd) {
+	if (c == '\n') {
+		if (line_length == 0) {
+			return 0; // Ignore blank lines
+		}
+		if (line_length > COMMAND_LINE_LENGTH) {
+			cmd->id = CMD_INVALID;
+			cmd->num_args = 0;
+		} else {
+			line[line_length] = '\0';
+			parse_line(cmd);
+		}
+		line_length = 0;
+		return 1;
+	}
+	if (c == '\b' || c == 0x7F) {
+		// Backspace/delete removes the last character (if the line
+		// hasn't already overflowed)
+		if (line_length > 0 && line_length <= COMMAND_LINE_LENGTH) {
+			line_length--;
+		}
+		return 0;
+	}
+	if (line_length < COMMAND_LINE_LENGTH) {
+		// Store keywords in lower case so they can be compared directly
+		if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		line[line_length++] = c;
+	} else {
+		line_length = COMMAND_LINE_LENGTH + 1; // Overflowed
+	}
+	return 0;
+}
+
+// Split the (null terminated) line into a keyword and numeric arguments
+static void parse_line(Command *cmd) {
+	char *p = line;
+	cmd->id = CMD_INVALID;
+	cmd->num_args = 0;
+
+	// Find the keyword
+	while (*p == ' ') {
+		p++;
+	}
+	char *keyword = p;
+	while (*p != ' ' && *p != '\0') {
+		p++;
+	}
+	if (*p != '\0') {
+		*p++ = '\0';
+	}
+	CommandId id = CMD_INVALID;
+	for (uint8_t i = 0; i < NUM_KEYWORDS; i++) {
+		if (strcmp_P(keyword, keywords[i]) == 0) {
+			id = (CommandId)(i + CMD_ENQUEUE);
+			break;
+		}
+	}
+	if (id == CMD_INVALID) {
+		return;
+	}
+
+	// Collect the arguments - anything other than unsigned decimal
+	// numbers (that fit in 32 bits) separated by spaces makes the command
+	// invalid
+	while (1) {
+		while (*p == ' ') {
+			p++;
+		}
+		if (*p == '\0') {
+			break;
+		}
+		if (cmd->num_args == COMMAND_MAX_ARGS) {
+			return;
+		}
+		uint32_t value = 0;
+		uint8_t digits = 0;
+		while (*p >= '0' && *p <= '9') {
+			uint8_t digit = *p++ - '0';
+			if (value > (UINT32_MAX - digit) / 10) {
+				return; // Too big
+			}
+			value = value * 10 + digit;
+			digits++;
+		}
+		if (digits == 0 || (*p != ' ' && *p != '\0')) {
+			return;
+		}
+		cmd->args[cmd->num_args++] = value;
+	}
+	cmd->id = id;
+}
@@ -0,0 +1,71 @@
+/*
+ * command.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Line based command parser for the serial port. Characters received
+ * from the serial port are fed in one at a time with command_add_char().
+ * When a line is complete (terminated by a newline) it is split into
+ * a keyword and up to COMMAND_MAX_ARGS unsigned decimal arguments (each
+ * no more than 4294967295), e.g.
+ *     enq 0 3
+ *     batch 0 3 1 2 3 0
+ *     speed 150
+ * Keywords are case insensitive. It is up to the caller to act on the
+ * command that is returned.
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+
+// Longest line (excluding the newline) that will be accepted. Longer
+// lines are discarded and reported as CMD_INVALID.
+#define COMMAND_LINE_LENGTH 40
+#define COMMAND_MAX_ARGS 8
+
+typedef enum {
+	CMD_INVALID = 0,	// Unknown keyword, bad argument or line too long
+	CMD_ENQUEUE,		// enq <origin> <destination>
+	CMD_BATCH,			// batch <origin> <destination> [<origin> <destination> ...]
+	CMD_SPEED,			// speed [<ms per row>] (no argument or 0 follows switch S2)
+	CMD_STATS,			// stats
+	CMD_RESET,			// reset (clear counters)
+	CMD_PAUSE,			// pause [0|1] (no argument toggles)
+	CMD_TELEMETRY,		// telemetry [0|1] (binary output, no argument toggles)
+	CMD_TRACE,			// trace [0] (dump the event trace, 0 clears it)
+	CMD_TXPOLICY,		// txpolicy <0|1|2> (block, drop newest, drop low priority)
+	CMD_REFRESH,		// refresh [<ms>] (terminal refresh period, no argument for default)
+	CMD_MIRROR,			// mirror [<ms>] (LED matrix mirror frame period, 0 stops it)
+	CMD_BAUD,			// baud <rate> (change the baud rate after replying)
+	CMD_BENCH,			// bench <bytes> (send a test pattern and report the time taken)
+	CMD_FLOW,			// flow [0|1] (XON/XOFF input flow control, no argument toggles)
+	CMD_PROFILE,		// profile [0] (show interrupt handler timings, 0 clears them)
+	CMD_SSD,			// ssd <digit> <mode> [<glyph>] (what the seven segment display shows)
+	CMD_BRIGHT,			// bright [<level>] (seven segment brightness 0-8, no argument for default)
+	CMD_BOOT,			// boot <0|1> (1 skips the start screen after a reset)
+	CMD_CHECKPOINT,		// ckpt [0] (show the EEPROM checkpoint statistics, 0 discards it)
+	CMD_CONFIG,			// cfg [<item> [<value>]] (list, reset or change a setting)
+	CMD_RAM				// ram (static RAM, stack high water mark and free RAM)
+} CommandId;
+
+typedef struct {
+	CommandId id;
+	uint8_t num_args;
+	uint32_t args[COMMAND_MAX_ARGS];
+} Command;
+
+/* Discard any partially received line. */
+void command_clear(void);
+
+/* Return non-zero if no characters of a line have been received yet. */
+int8_t command_line_empty(void);
+
+/* Add a received character to the current line. Returns 0 if the line is
+ * not yet complete (or was empty). Returns non-zero when c completes a
+ * line, in which case the parsed command is written to *cmd.
+ */
+int8_t command_add_char(char c, Command *cmd);
+
+#endif /* COMMAND_H_ */
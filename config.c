@@ -0,0 +1,125 @@
+/*
+ * config.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See config.h.
+ */
+
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include "config.h"
+#include "eeprom_map.h"
+
+typedef struct {
+	char name[8];
+	uint16_t min;
+	uint16_t max;
+	uint16_t initial;
+} ConfigInfo;
+
+// In ConfigItem order. Tones must be at least 250Hz to fit the timer 2
+// divider, and no longer than 250ms as the main loop waits for them.
+static const ConfigInfo info[CONFIG_NUM_ITEMS] PROGMEM = {
+	{"fast",	10,		10000,	100},
+	{"slow",	10,		10000,	300},
+	{"opening",	1,		5000,	300},
+	{"open",	1,		5000,	500},
+	{"closing",	1,		5000,	300},
+	{"closed",	1,		5000,	100},
+	{"step",	1,		5000,	400},
+	{"atone",	250,	20000,	500},
+	{"atonems",	0,		250,	100},
+	{"qtone",	250,	20000,	3000},
+	{"qtonems",	0,		250,	50},
+	{"maxq",	1,		MAX_TRAVELLERS,	MAX_TRAVELLERS}
+};
+
+// The settings as saved in EEPROM. The CRC covers the version and values.
+typedef struct {
+	uint8_t version;
+	uint16_t values[CONFIG_NUM_ITEMS];
+	uint16_t crc;
+} ConfigBlock;
+
+_Static_assert(sizeof(ConfigBlock) <= EEPROM_CONFIG_SIZE, "The settings don't fit in EEPROM_CONFIG_SIZE");
+
+uint16_t config_values[CONFIG_NUM_ITEMS];
+static ConfigSource source;
+
+static uint16_t block_crc(const ConfigBlock* block) {
+	uint16_t crc = 0xFFFF;
+	const uint8_t* bytes = (const uint8_t*)block;
+	for (uint8_t i = 0; i < sizeof(ConfigBlock) - 2; i++) {
+		crc = _crc_ccitt_update(crc, bytes[i]);
+	}
+	return crc;
+}
+
+static void save(void) {
+	ConfigBlock block;
+	block.version = CONFIG_VERSION;
+	for (uint8_t i = 0; i < CONFIG_NUM_ITEMS; i++) {
+		block.values[i] = config_values[i];
+	}
+	block.crc = block_crc(&block);
+	// Only the bytes that have changed are written
+	eeprom_update_block(&block, EEPROM_CONFIG, sizeof(block));
+}
+
+void init_config(void) {
+	ConfigBlock block;
+	eeprom_read_block(&block, EEPROM_CONFIG, sizeof(block));
+	if (block.version == 0xFF) {
+		source = CONFIG_DEFAULTS_BLANK;
+	} else if (block.version != CONFIG_VERSION) {
+		source = CONFIG_DEFAULTS_VERSION;
+	} else if (block.crc != block_crc(&block)) {
+		source = CONFIG_DEFAULTS_CORRUPT;
+	} else {
+		source = CONFIG_FROM_EEPROM;
+		for (uint8_t i = 0; i < CONFIG_NUM_ITEMS; i++) {
+			if (block.values[i] < config_min(i) || block.values[i] > config_max(i)) {
+				source = CONFIG_DEFAULTS_CORRUPT;
+			}
+		}
+	}
+	for (uint8_t i = 0; i < CONFIG_NUM_ITEMS; i++) {
+		config_values[i] = source == CONFIG_FROM_EEPROM ? block.values[i] : config_default(i);
+	}
+}
+
+uint8_t config_set(ConfigItem item, uint16_t value) {
+	if (value < config_min(item) || value > config_max(item)) {
+		return 0;
+	}
+	config_values[item] = value;
+	save();
+	return 1;
+}
+
+void config_set_default(ConfigItem item) {
+	config_values[item] = config_default(item);
+	save();
+}
+
+ConfigSource config_source(void) {
+	return source;
+}
+
+const char* config_name(ConfigItem item) {
+	return info[item].name;
+}
+
+uint16_t config_min(ConfigItem item) {
+	return pgm_read_word(&info[item].min);
+}
+
+uint16_t config_max(ConfigItem item) {
+	return pgm_read_word(&info[item].max);
+}
+
+uint16_t config_default(ConfigItem item) {
+	return pgm_read_word(&info[item].initial);
+}
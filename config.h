@@ -0,0 +1,84 @@
+/*
+ * config.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Settings that can be tuned without rebuilding - the elevator speeds,
+ * the door animation times, the buzzer tones and how many travellers can
+ * wait. They are kept in EEPROM (with a version number and a CRC) and
+ * copied to RAM by init_config(), so reading one costs no more than
+ * reading a variable. If the EEPROM copy is missing, was written by a
+ * different version or fails its CRC, the defaults are used until a
+ * setting is changed.
+ *
+ * Each setting has a range. config_set() refuses values outside it and
+ * saves the new settings to EEPROM straight away.
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stdint.h>
+
+// Most travellers that can wait (the size of the queue). The
+// CONFIG_MAX_TRAVELLERS setting can lower the limit.
+#ifndef MAX_TRAVELLERS
+#define MAX_TRAVELLERS 10
+#endif
+
+// Change this whenever the settings are changed, so that an old EEPROM
+// copy isn't used for the new ones
+#define CONFIG_VERSION 1
+
+typedef enum {
+	CONFIG_FAST_SPEED = 0,	// ms per row with switch S2 on
+	CONFIG_SLOW_SPEED,		// ms per row with switch S2 off
+	CONFIG_DOOR_OPENING,	// Picking up - ms for the doors to open
+	CONFIG_DOOR_OPEN,		// Picking up - ms the doors stay open
+	CONFIG_DOOR_CLOSING,	// Picking up - ms for the doors to close
+	CONFIG_DOOR_CLOSED,		// Picking up - ms before moving off
+	CONFIG_DOOR_STEP,		// Dropping off - ms for each of the three steps
+	CONFIG_ARRIVE_TONE,		// Tone on arriving at a floor (Hz)
+	CONFIG_ARRIVE_TONE_MS,
+	CONFIG_QUEUE_TONE,		// Tone when a traveller is queued (Hz)
+	CONFIG_QUEUE_TONE_MS,
+	CONFIG_MAX_TRAVELLERS,	// Most travellers that can wait (1 to MAX_TRAVELLERS)
+	CONFIG_NUM_ITEMS
+} ConfigItem;
+
+// Where the settings in use came from
+typedef enum {
+	CONFIG_FROM_EEPROM = 0,
+	CONFIG_DEFAULTS_BLANK,		// Nothing saved yet
+	CONFIG_DEFAULTS_VERSION,	// Saved by a different CONFIG_VERSION
+	CONFIG_DEFAULTS_CORRUPT		// Bad CRC or a value out of range
+} ConfigSource;
+
+extern uint16_t config_values[CONFIG_NUM_ITEMS];
+
+/* Load the settings from EEPROM, or the defaults if they can't be used. */
+void init_config(void);
+
+/* Return the value of a setting. */
+static inline uint16_t config_get(ConfigItem item) {
+	return config_values[item];
+}
+
+/* Change a setting and save the settings to EEPROM. Returns 0 (and
+ * changes nothing) if the value is out of range.
+ */
+uint8_t config_set(ConfigItem item, uint16_t value);
+
+/* Put a setting back to its default and save the settings to EEPROM. */
+void config_set_default(ConfigItem item);
+
+/* Return where the settings came from at start up. */
+ConfigSource config_source(void);
+
+/* Return a setting's short name (in program memory), range and default. */
+const char* config_name(ConfigItem item);
+uint16_t config_min(ConfigItem item);
+uint16_t config_max(ConfigItem item);
+uint16_t config_default(ConfigItem item);
+
+#endif /* CONFIG_H_ */
@@ -10,80 +10,50 @@
 #include "display.h"
 #include "pixel_colour.h"
 #include "ledmatrix.h"
+#include "matrix_mirror.h"
+#include "splash_assets.h"
+#include "timer0.h"
 
-// constant value used to display elevator on launch
-static const uint16_t elevator_display[MATRIX_NUM_COLUMNS] = {
-	(1<<7)|(1<<6)|(1<<5)|(0<<4)|(0<<3)|(1<<2)|(1<<1)|(1<<0) | (1<<8),
-	(0<<7)|(0<<6)|(1<<5)|(0<<4)|(0<<3)|(0<<2)|(0<<1)|(1<<0) | (1<<8),
-	(1<<7)|(1<<6)|(1<<5)|(0<<4)|(0<<3)|(1<<2)|(1<<1)|(1<<0) | (1<<8),
-	(0<<7)|(0<<6)|(1<<5)|(0<<4)|(0<<3)|(0<<2)|(0<<1)|(1<<0) | (1<<8),
-	(1<<7)|(1<<6)|(1<<5)|(0<<4)|(0<<3)|(1<<2)|(1<<1)|(1<<0) | (1<<8),
-	(0<<7)|(0<<6)|(0<<5)|(0<<4)|(0<<3)|(0<<2)|(0<<1)|(0<<0) | (1<<8),
-	
-	(1<<7)|(1<<6)|(1<<5)|(1<<4)|(1<<3)|(1<<2)|(1<<1)|(1<<0) | (0<<8),
-	(1<<7)|(1<<6)|(0<<5)|(0<<4)|(0<<3)|(0<<2)|(1<<1)|(1<<0) | (0<<8),
-	(1<<7)|(1<<6)|(1<<5)|(1<<4)|(1<<3)|(1<<2)|(1<<1)|(1<<0) | (0<<8),
-	(1<<7)|(0<<6)|(0<<5)|(0<<4)|(0<<3)|(0<<2)|(0<<1)|(1<<0) | (0<<8),
-	(1<<7)|(0<<6)|(0<<5)|(0<<4)|(0<<3)|(0<<2)|(0<<1)|(1<<0) | (0<<8),
-	(1<<7)|(0<<6)|(0<<5)|(0<<4)|(0<<3)|(0<<2)|(0<<1)|(1<<0) | (0<<8),
-	(1<<7)|(0<<6)|(0<<5)|(0<<4)|(0<<3)|(0<<2)|(0<<1)|(1<<0) | (0<<8),
-	(1<<7)|(0<<6)|(0<<5)|(0<<4)|(0<<3)|(0<<2)|(0<<1)|(1<<0) | (0<<8),
-	(1<<7)|(0<<6)|(0<<5)|(0<<4)|(0<<3)|(0<<2)|(0<<1)|(1<<0) | (0<<8),
-	(1<<7)|(1<<6)|(1<<5)|(1<<4)|(1<<3)|(1<<2)|(1<<1)|(1<<0) | (0<<8)
-	};
+// The start screen animation (see tools/splash.txt) - the step being
+// shown, when it was shown and how long for
+static uint8_t splash_step;
+static uint32_t splash_step_time;
+static uint16_t splash_step_ms;
 
 void initialise_display(void) {
-	// clear the LED matrix
+	// clear the LED matrix (and its copy on the terminal)
 	ledmatrix_clear();
+	matrix_mirror_clear();
+}
+
+// the steps are prepared LED matrix commands, so they can be sent
+// straight from program memory
+static void show_splash_step(uint8_t step) {
+	uint16_t offset = pgm_read_word(&splash_steps[step][0]);
+	uint16_t length = pgm_read_word(&splash_steps[step][1]);
+	ledmatrix_send_commands_P(splash_payload + offset, length);
+	splash_step = step;
+	splash_step_time = get_current_time();
+	splash_step_ms = pgm_read_word(&splash_steps[step][2]);
 }
 
 void start_display(void) {
-	PixelColour colour;
-	MatrixColumn column_colour_data;
-	uint16_t col_data;
-		
-	ledmatrix_clear(); // start by clearing the LED matrix
-	for (uint8_t col = 0; col < MATRIX_NUM_COLUMNS; col++) {
-		col_data = elevator_display[col];
-		// using the 9th bit as the colour determining bit, 1 is red, 0 is green
-		if (col_data & 0x0100) {
-			colour = COLOUR_RED;
-		} else {
-			colour = COLOUR_GREEN;
-		}
-		// go through the bottom 8 bits and set any to be the correct colour
-		for(uint8_t i = 0; i < 8; i++) {
-			if(col_data & 0x01) {
-				column_colour_data[i] = colour;
-				} else {
-				column_colour_data[i] = 0;
-			}
-			col_data >>= 1;
-		}
-		//column_colour_data[0] = 0;
-		ledmatrix_update_column(col, column_colour_data);
-	}
-	
+	// the first step clears the matrix and draws the whole screen
+	show_splash_step(0);
 }
 
-void start_display_animation(uint8_t frame) {
-	MatrixColumn column_colour_data;
-	uint16_t col_data;
-		
-	// Doors
-	for (uint8_t col = 9; col < MATRIX_NUM_COLUMNS-1; col++) {
-		col_data = (1<<7)|(1<<(3-frame))|(1<<(4+frame))|(1<<0);
-		// go through the bottom 8 bits and set any to be the correct colour
-		for(uint8_t i = 0; i < 8; i++) {
-			if(col_data & 0x01) {
-				column_colour_data[i] = COLOUR_GREEN;
-				} else {
-				column_colour_data[i] = 0;
-			}
-			col_data >>= 1;
+void start_display_animation(void) {
+	if (get_current_time() - splash_step_time < splash_step_ms) {
+		return;
+	}
+	uint8_t next = splash_step + 1;
+	if (next == SPLASH_NUM_STEPS) {
+		next = SPLASH_LOOP_STEP;
+		if (next == SPLASH_NUM_STEPS) {
+			return; // doesn't loop - stay on the last step
 		}
-		ledmatrix_update_column(col, column_colour_data);
 	}
+	show_splash_step(next);
 }
 
 
@@ -126,4 +96,5 @@ void update_square_colour(uint8_t x, uint8_t y, uint8_t object) {
 	 * to be interpreted as from bottom to top, not top to bottom.
 	 */
 	ledmatrix_update_pixel(15 - y, x, colour); 
+	matrix_mirror_set(x, y, colour);
 }
\ No newline at end of file
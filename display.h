@@ -52,9 +52,10 @@ void start_display(void);
 
 
 /*
- * animates start screen
+ * animates start screen - call this frequently after start_display(),
+ * it moves to the next frame when it is due
  */
-void start_display_animation(uint8_t frame);
+void start_display_animation(void);
 
 /*
  * updates the colour at square (x, y) to be the colour
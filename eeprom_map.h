@@ -0,0 +1,32 @@
+/*
+ * eeprom_map.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Where everything kept in the ATmega324A's 1KB of EEPROM lives. All
+ * EEPROM addresses are defined here so that nothing overlaps. An erased
+ * EEPROM reads as 0xFF, so every item must treat 0xFF as "not set".
+ */
+
+#ifndef EEPROM_MAP_H_
+#define EEPROM_MAP_H_
+
+#include <stdint.h>
+
+#define EEPROM_SIZE 1024
+
+// Boot mode (1 byte) - EEPROM_BOOT_FAST to skip the start screen, anything
+// else for a normal start
+#define EEPROM_BOOT_MODE ((uint8_t*)0x000)
+#define EEPROM_BOOT_FAST 0xB7
+
+// Checkpoints of the elevator's state (see checkpoint.h) - a ring of
+// CHECKPOINT_SLOTS slots of CHECKPOINT_SLOT_SIZE bytes
+#define EEPROM_CHECKPOINT ((uint8_t*)0x040)
+#define EEPROM_CHECKPOINT_END ((uint8_t*)0x340)
+
+// Tunable settings (see config.h) - version, values and CRC
+#define EEPROM_CONFIG ((uint8_t*)0x340)
+#define EEPROM_CONFIG_SIZE 64
+
+#endif /* EEPROM_MAP_H_ */
@@ -0,0 +1,126 @@
+/*
+ * inputs.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See inputs.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "inputs.h"
+#include "buttons.h"
+#include "profile.h"
+#include "trace.h"
+
+#if (SWITCH_QUEUE_SIZE & (SWITCH_QUEUE_SIZE - 1)) != 0 || SWITCH_QUEUE_SIZE > 128
+#error "SWITCH_QUEUE_SIZE must be a power of two no larger than 128"
+#endif
+#define SWITCH_QUEUE_MASK (SWITCH_QUEUE_SIZE - 1)
+
+#define SWITCH_PINS ((1 << SWITCH_S0) | (1 << SWITCH_S1) | (1 << SWITCH_S2))
+
+static uint8_t sample_count;
+static uint8_t buttons_at_reset;
+
+// Debounce state of the switches (INPUT_Sx bits) - a vertical counter,
+// as for the buttons. snapshot is the accepted state. Only used by
+// inputs_tick() apart from reading snapshot (one byte, so that's safe).
+static volatile uint8_t snapshot;
+static uint8_t count0;
+static uint8_t count1;
+
+// Switch events - a single producer, single consumer circular buffer
+// like the button queue. inputs_tick() adds at queue_head and the main
+// program takes from queue_tail.
+static volatile SwitchEvent switch_queue[SWITCH_QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+static volatile uint8_t queue_overruns;
+
+// Move the switch bits of a PINC value into INPUT_Sx order
+static uint8_t switch_bits(uint8_t pins) {
+	uint8_t bits = (pins >> SWITCH_S0) & ((1 << INPUT_S0) | (1 << INPUT_S1));
+	if(pins & (1 << SWITCH_S2)) {
+		bits |= (1 << INPUT_S2);
+	}
+	return bits;
+}
+
+void init_inputs(void) {
+	// Switches are inputs (with pull-ups)
+	DDRC &= ~SWITCH_PINS;
+	PORTC |= SWITCH_PINS;
+	init_buttons();
+	buttons_at_reset = PINB & 0x0F;
+
+	// Start with the switches as they are - they don't bounce while
+	// nobody is touching them
+	snapshot = switch_bits(PINC);
+	count0 = 0xFF;
+	count1 = 0xFF;
+	queue_head = 0;
+	queue_tail = 0;
+	queue_overruns = 0;
+}
+
+void inputs_tick(uint32_t now) {
+	if(++sample_count < BUTTON_SAMPLE_PERIOD) {
+		return;
+	}
+	sample_count = 0;
+	PROFILE_ENTER();
+
+	// Read each port once, so all the inputs are from the same instant
+	uint8_t pinb = PINB;
+	uint8_t pinc = PINC;
+
+	button_sample(now, pinb);
+
+	// Step the vertical counters of the switches that differ from the
+	// snapshot and reset the others (see button_sample())
+	uint8_t difference = snapshot ^ switch_bits(pinc);
+	count0 = ~(count0 & difference);
+	count1 = count0 ^ (count1 & difference);
+	uint8_t changed = difference & count0 & count1;
+	if(changed) {
+		uint8_t switches = snapshot ^ changed;
+		snapshot = switches;
+		trace_event(TRACE_SWITCH, switches);
+		uint8_t head = queue_head;
+		uint8_t next = (head + 1) & SWITCH_QUEUE_MASK;
+		if(next != queue_tail) {
+			switch_queue[head].time = now;
+			switch_queue[head].switches = switches;
+			switch_queue[head].changed = changed;
+			queue_head = next;
+		} else if(queue_overruns != 0xFF) {
+			queue_overruns++;
+		}
+	}
+	PROFILE_EXIT(PROFILE_INPUTS);
+}
+
+uint8_t inputs_buttons_at_reset(void) {
+	return buttons_at_reset;
+}
+
+uint8_t inputs_switches(void) {
+	return snapshot;
+}
+
+int8_t inputs_get_switch_event(SwitchEvent* event) {
+	uint8_t tail = queue_tail;
+	if(tail == queue_head) {
+		return 0;
+	}
+	event->time = switch_queue[tail].time;
+	event->switches = switch_queue[tail].switches;
+	event->changed = switch_queue[tail].changed;
+	queue_tail = (tail + 1) & SWITCH_QUEUE_MASK;
+	return 1;
+}
+
+uint8_t inputs_switch_overruns(void) {
+	return queue_overruns;
+}
@@ -0,0 +1,76 @@
+/*
+ * inputs.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Samples all of the IO board inputs together. Every BUTTON_SAMPLE_PERIOD
+ * ms the timer 0 tick reads PINB (push buttons B0 to B3) and PINC
+ * (switches S0, S1 and S2) once each. The buttons are passed on to the
+ * button debouncer (see buttons.h) and the switches are debounced here the
+ * same way - a switch only changes once it has read the same for 4 samples
+ * in a row.
+ *
+ * The debounced switch positions are kept as a snapshot that the rest of
+ * the program reads instead of the port, so everything sees the same,
+ * steady value. Each change of the snapshot is also queued as an event,
+ * with the clock tick it happened at.
+ */
+
+#ifndef INPUTS_H_
+#define INPUTS_H_
+
+#include <stdint.h>
+
+// Switch pins (port C)
+#define SWITCH_S0 PC2
+#define SWITCH_S1 PC3
+#define SWITCH_S2 PC7
+
+// Bits of the switch snapshot
+#define INPUT_S0 0			// Destination floor, bit 0
+#define INPUT_S1 1			// Destination floor, bit 1
+#define INPUT_S2 2			// Speed (1 = fast)
+
+// Number of switch events that can wait in the queue - must be a power of
+// two no larger than 128 (one slot is kept empty, so one fewer can wait)
+#ifndef SWITCH_QUEUE_SIZE
+#define SWITCH_QUEUE_SIZE 4
+#endif
+
+typedef struct {
+	uint32_t time;			// Clock tick when the switches changed
+	uint8_t switches;		// New snapshot (INPUT_Sx bits)
+	uint8_t changed;		// Switches that changed (INPUT_Sx bits)
+} SwitchEvent;
+
+/* Set up the switch and button pins, take the first snapshot of the
+ * switches and empty the event queues.
+ */
+void init_inputs(void);
+
+/* Sample the inputs. Must be called every millisecond with interrupts
+ * disabled (i.e. from the timer 0 interrupt handler), with the current
+ * clock tick.
+ */
+void inputs_tick(uint32_t now);
+
+/* Return the buttons (bit 0 for B0 etc.) that were held down when
+ * init_inputs() was called. These don't produce a press until they have
+ * been released.
+ */
+uint8_t inputs_buttons_at_reset(void);
+
+/* Return the debounced switch snapshot (INPUT_Sx bits). */
+uint8_t inputs_switches(void);
+
+/* Take the oldest switch change off the queue. Returns 0 if there are
+ * none, otherwise the event is written to *event and non-zero is returned.
+ */
+int8_t inputs_get_switch_event(SwitchEvent* event);
+
+/* Return the number of switch events discarded because the queue was
+ * full (since init_inputs() was called).
+ */
+uint8_t inputs_switch_overruns(void);
+
+#endif /* INPUTS_H_ */
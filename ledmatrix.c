@@ -2,11 +2,13 @@
  * ledmatrix.c
  *
  * Author: Peter Sutton
+ * Modified by Yiyang Yu
  * 
  * See the LED matrix Reference for details of the SPI commands used.
  */ 
 
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 #include "ledmatrix.h"
 #include "spi.h"
 
@@ -91,6 +93,12 @@ void ledmatrix_clear(void) {
 	(void)spi_send_byte(CMD_CLEAR_SCREEN);
 }
 
+void ledmatrix_send_commands_P(const uint8_t* commands, uint16_t length) {
+	while(length--) {
+		(void)spi_send_byte(pgm_read_byte(commands++));
+	}
+}
+
 void copy_matrix_column(MatrixColumn from, MatrixColumn to) {
 	for(uint8_t row = 0; row <MATRIX_NUM_ROWS; row++) {
 		to[row] = from[row];
@@ -2,6 +2,7 @@
  * ledmatrix.h
  *
  * Author: Peter Sutton
+ * Modified by Yiyang Yu
  */ 
 
 
@@ -41,6 +42,11 @@ void ledmatrix_shift_display_up(void);
 void ledmatrix_shift_display_down(void);
 void ledmatrix_clear(void);
 
+// Send a prepared sequence of LED matrix commands (as listed in the LED
+// matrix reference) from program memory, e.g. as made by
+// tools/gen_assets.py. The commands are not checked.
+void ledmatrix_send_commands_P(const uint8_t* commands, uint16_t length);
+
 // Functions to operate on MatrixRow and MatrixColumn data structures
 void copy_matrix_column(MatrixColumn from, MatrixColumn to);
 void copy_matrix_row(MatrixRow from, MatrixRow to);
@@ -0,0 +1,25 @@
+/*
+ * log_messages.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Table of log messages sent by binlog.c. Each entry gives the message
+ * id and its printf style format. The format is never stored on the
+ * AVR - only the id (the position in this table) and the raw arguments
+ * are sent. tools/log_decode.py reads this file to turn them back
+ * into text, so new messages must be added at the end.
+ *
+ * Every argument is sent as 16 bits, so formats may only use %u, %d,
+ * %x and %c (with optional width/flags).
+ *
+ * This file is included more than once - there is no include guard.
+ */
+
+LOG_MESSAGE(LOG_QUEUED, "Traveller queued %u -> %u (%u waiting)")
+LOG_MESSAGE(LOG_QUEUE_REJECTED, "Traveller %u -> %u rejected (%u waiting)")
+LOG_MESSAGE(LOG_PICKUP, "Picked up at floor %u (%u waiting)")
+LOG_MESSAGE(LOG_DROPOFF, "Dropped off at floor %u")
+LOG_MESSAGE(LOG_SPEED, "Speed set to %u ms per row")
+LOG_MESSAGE(LOG_PAUSE, "Paused: %u")
+LOG_MESSAGE(LOG_INPUT_OVERRUN, "Input overruns: %u")
+LOG_MESSAGE(LOG_PICKUP_LATENCY, "Picked up %u ms after the request")
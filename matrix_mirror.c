@@ -0,0 +1,151 @@
+/*
+ * matrix_mirror.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See matrix_mirror.h. Squares are stored as ANSI colour numbers (0-7),
+ * two to a byte, both for the field as it is now and for the frame last
+ * sent to the terminal. UNKNOWN in the sent frame means the terminal
+ * has to be redrawn there.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "matrix_mirror.h"
+#include "display.h"
+#include "terminalio.h"
+#include "serialio.h"
+#include "timer0.h"
+
+#define UNKNOWN 0x0F
+#define BYTES_PER_ROW (WIDTH / 2)
+
+// Rows are stored top (y = HEIGHT - 1) first, in the order they appear
+// on the terminal
+static uint8_t field[HEIGHT][BYTES_PER_ROW];
+static uint8_t sent[HEIGHT][BYTES_PER_ROW];
+
+static uint16_t frame_period = MATRIX_MIRROR_PERIOD;
+static uint32_t last_frame;
+
+static uint8_t get_square(uint8_t frame[][BYTES_PER_ROW], uint8_t row, uint8_t x) {
+	uint8_t pair = frame[row][x >> 1];
+	return (x & 1) ? pair >> 4 : pair & 0x0F;
+}
+
+// Convert a pixel colour to the ANSI colour number (BG_BLACK + n) that
+// looks closest while keeping the playing field objects distinguishable
+static uint8_t colour_index(PixelColour colour) {
+	switch (colour) {
+		case COLOUR_BLACK:			return 0;
+		case COLOUR_RED:			return 1;
+		case COLOUR_GREEN:			return 2;
+		case COLOUR_YELLOW:			return 3;
+		case COLOUR_ORANGE:			return 3;
+		case COLOUR_LIGHT_RED:		return 5;	// Magenta
+		case COLOUR_LIGHT_GREEN:	return 6;	// Cyan
+		case COLOUR_LIGHT_YELLOW:	return 3;
+		case COLOUR_LIGHT_ORANGE:	return 7;	// White
+	}
+	// Anything else - decide from the red (low) and green (high) nibbles
+	uint8_t red = colour & 0x0F;
+	uint8_t green = colour >> 4;
+	if (red && green) {
+		return 3;
+	} else if (red) {
+		return 1;
+	} else if (green) {
+		return 2;
+	}
+	return 0;
+}
+
+void matrix_mirror_set(uint8_t x, uint8_t y, PixelColour colour) {
+	if (x >= WIDTH || y >= HEIGHT) {
+		return;
+	}
+	uint8_t *pair = &field[HEIGHT - 1 - y][x >> 1];
+	uint8_t index = colour_index(colour);
+	if (x & 1) {
+		*pair = (*pair & 0x0F) | (index << 4);
+	} else {
+		*pair = (*pair & 0xF0) | index;
+	}
+}
+
+void matrix_mirror_clear(void) {
+	memset(field, 0, sizeof(field));
+}
+
+void matrix_mirror_invalidate(void) {
+	memset(sent, (UNKNOWN << 4) | UNKNOWN, sizeof(sent));
+}
+
+void matrix_mirror_invalidate_row(uint8_t terminal_row) {
+	if (terminal_row >= MATRIX_MIRROR_ROW && terminal_row < MATRIX_MIRROR_ROW + HEIGHT) {
+		memset(sent[terminal_row - MATRIX_MIRROR_ROW], (UNKNOWN << 4) | UNKNOWN, BYTES_PER_ROW);
+	}
+}
+
+void matrix_mirror_set_period(uint16_t period) {
+	if (period != 0 && frame_period == 0) {
+		// Whatever the terminal shows now may be out of date
+		matrix_mirror_invalidate();
+	}
+	frame_period = period;
+}
+
+uint16_t matrix_mirror_get_period(void) {
+	return frame_period;
+}
+
+int8_t matrix_mirror_refresh(void) {
+	uint32_t now = get_current_time();
+	int8_t sent_any = 0;
+	if (frame_period == 0 || now - last_frame < frame_period) {
+		return 0;
+	}
+	last_frame = now;
+
+	for (uint8_t row = 0; row < HEIGHT; row++) {
+		if (memcmp(field[row], sent[row], BYTES_PER_ROW) == 0) {
+			continue;
+		}
+
+		if (serial_begin_message(SERIAL_PRIORITY_LOW)) {
+			// Put the cursor back afterwards so that characters typed
+			// (and echoed) don't land in the mirror
+			save_cursor();
+			uint8_t colour = UNKNOWN;	// Background colour last set
+			uint8_t cursor_x = 0xFF;	// Square the cursor is on, if in this row
+			for (uint8_t x = 0; x < WIDTH; x++) {
+				uint8_t square = get_square(field, row, x);
+				if (square == get_square(sent, row, x)) {
+					continue;
+				}
+				if (cursor_x == 0xFF) {
+					move_terminal_cursor(MATRIX_MIRROR_COLUMN + 2 * x, MATRIX_MIRROR_ROW + row);
+				} else if (cursor_x != x) {
+					move_terminal_cursor_right(2 * (x - cursor_x));
+				}
+				if (square != colour) {
+					set_display_attribute((DisplayParameter)(BG_BLACK + square));
+					colour = square;
+				}
+				serial_write_P(PSTR("  "));
+				cursor_x = x + 1;
+			}
+			normal_display_mode();
+			restore_cursor();
+		}
+		if (!serial_end_message()) {
+			// The port is busy - leave the rest for the next frame
+			break;
+		}
+		memcpy(sent[row], field[row], BYTES_PER_ROW);
+		sent_any = 1;
+	}
+	return sent_any;
+}
@@ -0,0 +1,73 @@
+/*
+ * matrix_mirror.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Mirror of the LED matrix playing field on the serial terminal, drawn
+ * as coloured blocks (two spaces with an ANSI background colour per
+ * square). The field is shown the way the elevator sees it - WIDTH
+ * columns by HEIGHT rows with row 0 at the bottom - to the right of the
+ * status lines.
+ *
+ * update_square_colour() records every square it sets here. Each refresh
+ * compares the field with the last frame sent and sends only the squares
+ * that differ, so a typical elevator move costs a few tens of bytes.
+ * Frames are sent at most once every frame period. Each terminal row is
+ * sent as its own low priority serial message - rows that are dropped
+ * because the serial port is busy are sent in a later frame.
+ *
+ * The terminal only has 8 background colours, so the pixel_colour.h
+ * colours are mapped onto the nearest distinct one (see colour_index()
+ * in matrix_mirror.c).
+ */
+
+#ifndef MATRIX_MIRROR_H_
+#define MATRIX_MIRROR_H_
+
+#include <stdint.h>
+#include "pixel_colour.h"
+
+// Terminal position (column, row) of the top left of the mirror
+#ifndef MATRIX_MIRROR_COLUMN
+#define MATRIX_MIRROR_COLUMN 40
+#endif
+#ifndef MATRIX_MIRROR_ROW
+#define MATRIX_MIRROR_ROW 1
+#endif
+
+// Default minimum time between frames (ms)
+#ifndef MATRIX_MIRROR_PERIOD
+#define MATRIX_MIRROR_PERIOD 100
+#endif
+
+/* Record that square (x, y) of the playing field (as used by
+ * update_square_colour()) is now the given colour.
+ */
+void matrix_mirror_set(uint8_t x, uint8_t y, PixelColour colour);
+
+/* Set every square of the playing field to black. */
+void matrix_mirror_clear(void);
+
+/* Forget what the terminal shows, so the next frames redraw the whole
+ * mirror (e.g. after the terminal has been cleared).
+ */
+void matrix_mirror_invalidate(void);
+
+/* Forget what the terminal shows on the given terminal row (e.g. after
+ * other output has been written across it). Rows outside the mirror are
+ * ignored.
+ */
+void matrix_mirror_invalidate_row(uint8_t terminal_row);
+
+/* Set the minimum time (ms) between frames. 0 stops the mirror (nothing
+ * more is sent until it is started again, when it is redrawn in full).
+ */
+void matrix_mirror_set_period(uint16_t period);
+uint16_t matrix_mirror_get_period(void);
+
+/* Send the next frame if the mirror is running and the frame period has
+ * passed. Returns non-zero if anything was sent.
+ */
+int8_t matrix_mirror_refresh(void);
+
+#endif /* MATRIX_MIRROR_H_ */
@@ -0,0 +1,70 @@
+/*
+ * profile.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See profile.h. Nothing here is compiled unless PROFILE is defined.
+ */
+
+#include "profile.h"
+
+#ifdef PROFILE
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+// Written by the interrupt handlers, so only read with interrupts off
+ProfileStats profile_stats[PROFILE_NUM_SLOTS];
+uint8_t profile_tick_latency;
+
+// Slot names in ProfileSlot order
+static const char slot_names[PROFILE_NUM_SLOTS][7] PROGMEM = {
+	"timer0",
+	"rx",
+	"udre",
+	"inputs",
+	"ssd"
+};
+
+void init_profile(void) {
+	profile_clear();
+	// Normal mode, no prescaling - TCNT1 counts CPU cycles and wraps
+	// every 65536 (8.2ms at 8MHz, far longer than any handler should take)
+	TCCR1A = 0;
+	TCCR1B = (1 << CS10);
+}
+
+void profile_get(ProfileSlot slot, ProfileStats* stats) {
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	*stats = profile_stats[slot];
+	if (interrupts_were_enabled) {
+		sei();
+	}
+}
+
+uint8_t profile_get_tick_latency(void) {
+	return profile_tick_latency;
+}
+
+void profile_clear(void) {
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	for (uint8_t i = 0; i < PROFILE_NUM_SLOTS; i++) {
+		profile_stats[i].count = 0;
+		profile_stats[i].max_cycles = 0;
+		profile_stats[i].total_cycles = 0;
+	}
+	profile_tick_latency = 0;
+	if (interrupts_were_enabled) {
+		sei();
+	}
+}
+
+const char* profile_slot_name(ProfileSlot slot) {
+	return slot_names[slot];
+}
+
+#endif /* PROFILE */
@@ -0,0 +1,97 @@
+/*
+ * profile.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Measures how long the interrupt handlers take, in CPU cycles, using
+ * timer 1 running freely at the CPU clock. Each instrumented handler
+ * records how many times it has run and its longest and total duration.
+ * The time from the timer 0 compare match to its handler starting is also
+ * recorded (in timer 0 counts of 8us) - this shows how much other
+ * handlers delay the 1ms tick.
+ *
+ * Profiling is only compiled in when PROFILE is defined (e.g. -DPROFILE
+ * on the compiler command line). Otherwise the macros below are empty and
+ * it costs nothing. The measured durations don't include the handler's
+ * entry and exit code (register saving etc., typically 20-40 cycles) or
+ * the 4+ cycles taken to respond to the interrupt.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+typedef enum {
+	PROFILE_TIMER0 = 0,		// 1ms tick (TIMER0_COMPA_vect)
+	PROFILE_SERIAL_RX,		// USART0_RX_vect
+	PROFILE_SERIAL_UDRE,	// USART0_UDRE_vect
+	PROFILE_INPUTS,			// inputs_tick() (part of the timer 0 handler)
+	PROFILE_SSD_LIGHT,		// TIMER0_COMPB_vect (seven segment lighting)
+	PROFILE_NUM_SLOTS
+} ProfileSlot;
+
+typedef struct {
+	uint16_t count;			// Number of times run (stops at 65535)
+	uint16_t max_cycles;
+	uint32_t total_cycles;
+} ProfileStats;
+
+#ifdef PROFILE
+
+#include <avr/io.h>
+
+extern ProfileStats profile_stats[PROFILE_NUM_SLOTS];
+extern uint8_t profile_tick_latency;
+
+/* Start timer 1 counting CPU cycles. */
+void init_profile(void);
+
+/* Copy the statistics for slot to *stats. */
+void profile_get(ProfileSlot slot, ProfileStats* stats);
+
+/* Return the longest delay (in timer 0 counts) seen before the timer 0
+ * handler started.
+ */
+uint8_t profile_get_tick_latency(void);
+
+/* Reset all of the statistics. */
+void profile_clear(void);
+
+/* Return a short name (in program memory) for a slot. */
+const char* profile_slot_name(ProfileSlot slot);
+
+/* PROFILE_ENTER() must be the first statement of an interrupt handler
+ * and PROFILE_EXIT(slot) the last. The recording is inline so that it
+ * doesn't make the handler save more registers than it otherwise would.
+ */
+#define PROFILE_ENTER() uint16_t profile_start_ = TCNT1
+#define PROFILE_EXIT(slot) profile_record((slot), TCNT1 - profile_start_)
+#define PROFILE_TICK_LATENCY() do { \
+		uint8_t latency_ = TCNT0; \
+		if (latency_ > profile_tick_latency) { \
+			profile_tick_latency = latency_; \
+		} \
+	} while (0)
+
+static inline void profile_record(ProfileSlot slot, uint16_t cycles) {
+	ProfileStats* stats = &profile_stats[slot];
+	if (stats->count != 0xFFFF) {
+		stats->count++;
+		stats->total_cycles += cycles;
+	}
+	if (cycles > stats->max_cycles) {
+		stats->max_cycles = cycles;
+	}
+}
+
+#else
+
+#define init_profile()
+#define PROFILE_ENTER()
+#define PROFILE_EXIT(slot)
+#define PROFILE_TICK_LATENCY()
+
+#endif /* PROFILE */
+
+#endif /* PROFILE_H_ */
@@ -0,0 +1,63 @@
+/*
+ * ram.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See ram.h.
+ */
+
+#include <avr/io.h>
+#include "ram.h"
+
+// Set up by the linker (and malloc()). The stack starts at __stack
+// (RAMEND) and grows down towards the heap, which starts at
+// __heap_start and grows up to __brkval.
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t __heap_start;
+extern uint8_t __stack;
+extern char* __brkval;
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+/* Paint the RAM between the static variables and the top of the stack.
+ * Run from the .init1 section, before the C runtime has set up the stack
+ * pointer or cleared r1, so it must not use the stack or assume r1 is
+ * zero. Compiled C can't promise that (e.g. without optimisation it keeps
+ * variables on the stack), so the loop is written in assembler, in the
+ * call-clobbered Z, r24 and r25.
+ */
+void ram_paint(void) __attribute__((naked, used, section(".init1")));
+
+void ram_paint(void) {
+	__asm__ volatile (
+		"	ldi r30, lo8(__heap_start)\n"
+		"	ldi r31, hi8(__heap_start)\n"
+		"	ldi r24, " STRINGIFY(RAM_PAINT) "\n"
+		"	ldi r25, hi8(__stack + 1)\n"
+		"1:	st Z+, r24\n"
+		"	cpi r30, lo8(__stack + 1)\n"
+		"	cpc r31, r25\n"
+		"	brne 1b\n"
+	);
+}
+
+void ram_get_usage(RamUsage* usage) {
+	uint8_t* heap_end = __brkval ? (uint8_t*)__brkval : &__heap_start;
+
+	// Find the lowest byte the stack (or heap) has touched
+	uint8_t* p = heap_end;
+	while (p <= &__stack && *p == RAM_PAINT) {
+		p++;
+	}
+
+	usage->data = &__data_end - &__data_start;
+	usage->bss = &__bss_end - &__bss_start;
+	usage->heap = heap_end - &__heap_start;
+	usage->stack_now = &__stack - (uint8_t*)SP;
+	usage->stack_max = &__stack + 1 - p;
+	usage->free_min = p - heap_end;
+}
@@ -0,0 +1,39 @@
+/*
+ * ram.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Measures how the ATmega324A's 2KB of RAM is being used. Before main()
+ * starts (and before anything has been put on the stack) all of the RAM
+ * above the static variables is filled with RAM_PAINT. The stack grows
+ * down into this from the top, so the deepest it has ever been is where
+ * the paint is still untouched - the high water mark. That covers
+ * everything, including interrupt handlers and printf(), however briefly
+ * it happened.
+ *
+ * The split of the static variables between modules isn't known on the
+ * chip - tools/ram_report.py works it out from the linker map file.
+ */
+
+#ifndef RAM_H_
+#define RAM_H_
+
+#include <stdint.h>
+
+#define RAM_PAINT 0xC5
+
+typedef struct {
+	uint16_t data;			// Initialised static variables (.data)
+	uint16_t bss;			// Zeroed static variables (.bss)
+	uint16_t heap;			// Allocated with malloc()
+	uint16_t stack_now;		// Stack in use now
+	uint16_t stack_max;		// Most stack ever used (the high water mark)
+	uint16_t free_min;		// Least free space there has been between the heap and the stack
+} RamUsage;
+
+/* Fill in *usage. Looking for the high water mark takes about 6 cycles
+ * for each byte that has never been used.
+ */
+void ram_get_usage(RamUsage* usage);
+
+#endif /* RAM_H_ */
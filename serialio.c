@@ -10,7 +10,9 @@
  * to print many characters at once to the buffer and have them 
  * output by the UART as speed permits.) If the buffer fills up, the
  * put method will either
- * (1) if interrupts are enabled, block until there is room in it, or
+ * (1) if interrupts are enabled, block until there is room in it or
+ * discard the character, depending on the output policy (see
+ * serial_set_tx_policy()), or
  * (2) if interrupts are disabled, will discard the character.
  * Input is blocking - requesting input from stdin will block
  * until a character is available. If interrupts are disabled when 
@@ -25,46 +27,141 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 
-/* System clock rate in Hz. (L at the end indicates this is a long constant) */
-#define SYSCLK 8000000L
+#include "serialio.h"
+#include "profile.h"
+#include "trace.h"
+
+/* System clock rate in Hz. This is normally given on the compiler command
+ * line (-DF_CPU=...) - the default matches the main program.
+ * (L at the end indicates this is a long constant)
+ */
+#ifndef F_CPU
+#define F_CPU 8000000L
+#endif
 
 /* Global variables */
-/* Circular buffer to hold outgoing characters. The insert_pos variable
- * keeps track of the position (0 to OUTPUT_BUFFER_SIZE-1) that the next
- * outgoing character should be written to. bytes_in_buffer keeps
- * count of the number of characters currently stored in the buffer 
- * (ranging from 0 to OUTPUT_BUFFER_SIZE). This number of bytes immediately
- * prior to the current insert_pos are the bytes waiting to be output.
- * If the insert_pos reaches the end of the buffer it will wrap around
- * to the beginning (assuming those bytes have been output).
- * NOTE - OUTPUT_BUFFER_SIZE can not be larger than 255 without changing
- * the type of the variables below (currently defined as 8 bit unsigned ints).
+/* The output and input buffers are single producer, single consumer
+ * circular buffers. For output, the main program is the only thing that
+ * adds bytes (advancing out_head) and the UDRE interrupt handler is the
+ * only thing that removes them (advancing out_tail). For input it is the
+ * other way around. Each index is only ever written by one side, so
+ * neither side needs to turn interrupts off to use the buffer.
+ * The main program writes at out_fill. This is normally the same as
+ * out_head, but while a message that mustn't wait is being output it runs
+ * ahead - the message is only handed to the ISR (by moving out_head up to
+ * out_fill) once all of it has fitted, so a message is never cut short.
+ * The buffer is empty when head == tail. One slot is always left unused so
+ * that a full buffer (head one behind tail) can be told apart from an
+ * empty one - a buffer of size N holds up to N-1 bytes.
+ * Buffer sizes must be powers of two so that wrapping around is just a
+ * mask. Sizes up to 256 use 8 bit indices. Larger sizes use 16 bit
+ * indices - these can't be read or written in a single instruction, so
+ * the few accesses to an index owned by the other side are protected
+ * (see the read_/write_ functions below).
  */
-#define OUTPUT_BUFFER_SIZE 255
-volatile char out_buffer[OUTPUT_BUFFER_SIZE];
-volatile uint8_t out_insert_pos;
-volatile uint8_t bytes_in_out_buffer;
+#ifndef OUTPUT_BUFFER_SIZE
+#define OUTPUT_BUFFER_SIZE 256
+#endif
+#ifndef INPUT_BUFFER_SIZE
+#define INPUT_BUFFER_SIZE 64
+#endif
 
-/* Circular buffer to hold incoming characters. Works on same principle
- * as output buffer
+/* With flow control on, XOFF is sent when the input buffer holds
+ * SERIAL_XOFF_LEVEL characters, and XON once it has been read down to
+ * SERIAL_XON_LEVEL. The space above the XOFF level absorbs whatever the
+ * sender has already committed to sending (USB serial adapters can send
+ * a few dozen more characters after XOFF).
  */
-#define INPUT_BUFFER_SIZE 16
-volatile char input_buffer[INPUT_BUFFER_SIZE];
-volatile uint8_t input_insert_pos;
-volatile uint8_t bytes_in_input_buffer;
-volatile uint8_t input_overrun;
+#ifndef SERIAL_XOFF_LEVEL
+#define SERIAL_XOFF_LEVEL (INPUT_BUFFER_SIZE / 2)
+#endif
+#ifndef SERIAL_XON_LEVEL
+#define SERIAL_XON_LEVEL (INPUT_BUFFER_SIZE / 4)
+#endif
+#if SERIAL_XON_LEVEL >= SERIAL_XOFF_LEVEL || SERIAL_XOFF_LEVEL >= INPUT_BUFFER_SIZE
+#error "Need SERIAL_XON_LEVEL < SERIAL_XOFF_LEVEL < INPUT_BUFFER_SIZE"
+#endif
+#define XON 0x11
+#define XOFF 0x13
+
+#if (OUTPUT_BUFFER_SIZE & (OUTPUT_BUFFER_SIZE - 1)) != 0 || OUTPUT_BUFFER_SIZE > 32768
+#error "OUTPUT_BUFFER_SIZE must be a power of two no larger than 32768"
+#endif
+#if (INPUT_BUFFER_SIZE & (INPUT_BUFFER_SIZE - 1)) != 0 || INPUT_BUFFER_SIZE > 32768
+#error "INPUT_BUFFER_SIZE must be a power of two no larger than 32768"
+#endif
+
+#define OUTPUT_BUFFER_MASK (OUTPUT_BUFFER_SIZE - 1)
+#define INPUT_BUFFER_MASK (INPUT_BUFFER_SIZE - 1)
+
+#if OUTPUT_BUFFER_SIZE > 256
+typedef uint16_t out_index_t;
+#else
+typedef uint8_t out_index_t;
+#endif
+#if INPUT_BUFFER_SIZE > 256
+typedef uint16_t in_index_t;
+#else
+typedef uint8_t in_index_t;
+#endif
+
+static volatile char out_buffer[OUTPUT_BUFFER_SIZE];
+static volatile out_index_t out_head;	/* Written by main program only */
+static volatile out_index_t out_tail;	/* Written by UDRE ISR only */
+static out_index_t out_fill;	/* Main program only - see above */
+
+static volatile char input_buffer[INPUT_BUFFER_SIZE];
+static volatile in_index_t input_head;	/* Written by RX ISR only */
+static volatile in_index_t input_tail;	/* Written by main program only */
+static volatile uint16_t input_overrun_count;
+static volatile uint16_t hardware_overrun_count;	/* DOR - UDR0 not read in time */
+static volatile uint16_t framing_error_count;	/* FE - bad stop bit */
+static uint8_t traced_overruns;	/* Low byte of input_overrun_count when last traced */
+
+/* Flow control state. flow_char is XON or XOFF while one is waiting to be
+ * sent (ahead of the output buffer) by the UDRE ISR, or 0. flow_stopped
+ * is set when XOFF has been asked for and cleared when XON is. Both are
+ * only changed with interrupts off (or in an ISR).
+ */
+static int8_t flow_control;
+static volatile uint8_t flow_char;
+static volatile uint8_t flow_stopped;
+static volatile uint16_t xoff_count;
 
 /* Variable to keep track of whether incoming characters are to be echoed
  * back or not.
  */
 static int8_t do_echo;
 
+/* Baud rate last asked for */
+static uint32_t baud;
+
+/* What to do when the output buffer is full, and the state of the message
+ * currently being output (if any). These and the drop counts are only used
+ * by the main program.
+ */
+static SerialTxPolicy tx_policy;
+typedef enum {
+	MESSAGE_NONE,		/* Not in a message (or message may block) */
+	MESSAGE_NO_WAIT,	/* In a message that mustn't wait for room (held
+						 * back from the ISR until it is complete) */
+	MESSAGE_DROPPING	/* Discarding the rest of a message */
+} MessageState;
+static MessageState message_state;
+static uint16_t tx_dropped_bytes;
+static uint16_t tx_dropped_messages;
+
 /* Function prototypes 
  */
 void init_serial_stdio(long baudrate, int8_t echo);
 static int uart_put_char(char, FILE*);
+static void publish_output(out_index_t head);
+static int8_t put_byte(uint8_t c);
+static void put_block(const char* data, uint8_t length, uint8_t in_progmem);
 static int uart_get_char(FILE*);
+static uint16_t baud_settings(uint32_t baudrate, uint16_t* ubrr, uint8_t* u2x);
 
 /* Setup a stream that uses the uart get and put functions. We will
  * make standard input and output use this stream below.
@@ -72,16 +169,81 @@ static int uart_get_char(FILE*);
 static FILE myStream = FDEV_SETUP_STREAM(uart_put_char, uart_get_char,
 		_FDEV_SETUP_RW);
 
+/* Access to the indices owned by an interrupt handler from the main
+ * program. An 8 bit index is always read or written in one go. A 16 bit
+ * index owned by an ISR is read until two reads agree (the ISR can't
+ * be interrupted, so it can only change the value between our reads,
+ * not during them). A 16 bit index we own is written with interrupts
+ * off so that the ISR never sees half of it. The tests on sizeof are
+ * resolved by the compiler.
+ */
+static inline out_index_t read_out_tail(void) {
+	out_index_t tail = out_tail;
+	if(sizeof(out_index_t) > 1) {
+		out_index_t again;
+		while((again = out_tail) != tail) {
+			tail = again;
+		}
+	}
+	return tail;
+}
+
+static inline void write_out_head(out_index_t head) {
+	if(sizeof(out_index_t) > 1) {
+		uint8_t sreg = SREG;
+		cli();
+		out_head = head;
+		SREG = sreg;
+	} else {
+		out_head = head;
+	}
+}
+
+static inline in_index_t read_input_head(void) {
+	in_index_t head = input_head;
+	if(sizeof(in_index_t) > 1) {
+		in_index_t again;
+		while((again = input_head) != head) {
+			head = again;
+		}
+	}
+	return head;
+}
+
+static inline void write_input_tail(in_index_t tail) {
+	if(sizeof(in_index_t) > 1) {
+		uint8_t sreg = SREG;
+		cli();
+		input_tail = tail;
+		SREG = sreg;
+	} else {
+		input_tail = tail;
+	}
+}
+
 void init_serial_stdio(long baudrate, int8_t echo) {
 	uint16_t ubrr;
+	uint8_t u2x;
 	/*
 	 * Initialise our buffers
 	*/
-	out_insert_pos = 0;
-	bytes_in_out_buffer = 0;
-	input_insert_pos = 0;
-	bytes_in_input_buffer = 0;
-	input_overrun = 0;
+	out_head = 0;
+	out_tail = 0;
+	out_fill = 0;
+	input_head = 0;
+	input_tail = 0;
+	input_overrun_count = 0;
+	traced_overruns = 0;
+	hardware_overrun_count = 0;
+	framing_error_count = 0;
+	flow_control = 0;
+	flow_char = 0;
+	flow_stopped = 0;
+	xoff_count = 0;
+	tx_policy = SERIAL_TX_BLOCK;
+	message_state = MESSAGE_NONE;
+	tx_dropped_bytes = 0;
+	tx_dropped_messages = 0;
 	
 	/*
 	 * Record whether we're going to echo characters or not
@@ -89,12 +251,10 @@ void init_serial_stdio(long baudrate, int8_t echo) {
 	do_echo = echo;
 	
 	/* Configure the serial port baud rate */
-	/* (This differs from the datasheet formula so that we get 
-	 * rounding to the nearest integer while using integer division
-	 * (which truncates)).
-	*/
-	ubrr = ((SYSCLK / (8 * baudrate)) + 1)/2 - 1;
+	baud = baudrate;
+	baud_settings(baudrate, &ubrr, &u2x);
 	UBRR0 = ubrr;
+	UCSR0A = u2x ? (1 << U2X0) : 0;
 	
 	/*
 	 * Enable transmission and receiving via UART. We don't enable
@@ -118,98 +278,377 @@ void init_serial_stdio(long baudrate, int8_t echo) {
 	stdin = &myStream;
 }
 
+/* Work out the UBRR value and U2X bit that give the rate closest to
+ * baudrate, and return the error in tenths of a percent. Normal speed is
+ * used unless double speed is more accurate, as the receiver is more
+ * tolerant of timing errors at normal speed.
+ */
+static uint16_t baud_settings(uint32_t baudrate, uint16_t* ubrr, uint8_t* u2x) {
+	uint16_t best_error = 0xFFFF;
+	*ubrr = 0;
+	*u2x = 1;
+	if (baudrate == 0 || baudrate > F_CPU / 8) {
+		return best_error;	/* Too fast (and would overflow below) */
+	}
+	for (uint8_t double_speed = 0; double_speed <= 1; double_speed++) {
+		uint32_t clocks_per_bit = 16 >> double_speed;
+		/* (This differs from the datasheet formula so that we get 
+		 * rounding to the nearest integer while using integer division
+		 * (which truncates)).
+		*/
+		uint32_t divisor = (F_CPU + clocks_per_bit * baudrate / 2) / (clocks_per_bit * baudrate);
+		if (divisor == 0) {
+			divisor = 1;	/* As fast as the UART goes */
+		} else if (divisor > 4096) {
+			divisor = 4096;	/* As slow as the UART goes */
+		}
+		/* Compare the clock with what it would have to be for the exact
+		 * rate (this avoids rounding the actual rate)
+		 */
+		uint32_t needed = clocks_per_bit * divisor * baudrate;
+		uint32_t difference = needed > F_CPU ? needed - F_CPU : F_CPU - needed;
+		uint32_t error = difference / (needed / 1000);
+		if (error < best_error) {
+			best_error = error > 0xFFFE ? 0xFFFE : error;
+			*ubrr = divisor - 1;
+			*u2x = double_speed;
+		}
+	}
+	return best_error;
+}
+
+uint16_t serial_baud_error(uint32_t baudrate) {
+	uint16_t ubrr;
+	uint8_t u2x;
+	return baud_settings(baudrate, &ubrr, &u2x);
+}
+
+int8_t serial_set_baud(uint32_t baudrate) {
+	uint16_t ubrr;
+	uint8_t u2x;
+	if (baud_settings(baudrate, &ubrr, &u2x) > SERIAL_MAX_BAUD_ERROR
+			|| !bit_is_set(SREG, SREG_I)) {
+		return 0;
+	}
+
+	/* Let the output buffer empty at the old rate, then wait for the last
+	 * byte to leave the shift register. TXC is cleared when the buffer
+	 * empties (see the UDRE handler) so it is only set again once that
+	 * byte has gone - but if the transmitter had already finished it
+	 * never will be, so give up after one frame time. (A frame is at most
+	 * 11 bits of 16 clocks and each pass of the loop takes at least 4.)
+	 */
+	while (UCSR0B & (1 << UDRIE0)) {
+		;
+	}
+	for (uint32_t i = 44UL * (UBRR0 + 1); i > 0 && !(UCSR0A & (1 << TXC0)); i--) {
+		;
+	}
+
+	baud = baudrate;
+	UBRR0 = ubrr;
+	UCSR0A = u2x ? (1 << U2X0) : 0;
+	return 1;
+}
+
+uint32_t serial_get_baud(void) {
+	return baud;
+}
+
 int8_t serial_input_available(void) {
-	return (bytes_in_input_buffer != 0);
+	/* The RX ISR doesn't call trace_event() (to stay short), so record
+	 * any characters lost since we last looked here instead. (The low
+	 * byte of the count can be read without turning interrupts off.)
+	 */
+	uint8_t overruns = (uint8_t)input_overrun_count;
+	if(overruns != traced_overruns) {
+		traced_overruns = overruns;
+		trace_event(TRACE_OVERFLOW, TRACE_OVERFLOW_SERIAL_RX);
+	}
+	return (read_input_head() != input_tail);
+}
+
+/* The counts are 16 bits and are modified by the receive ISR, so
+ * we turn interrupts off while we copy them.
+ */
+static uint16_t read_count(volatile uint16_t* count) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	uint16_t value = *count;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return value;
+}
+
+uint16_t serial_input_overrun_count(void) {
+	return read_count(&input_overrun_count);
+}
+
+uint16_t serial_hardware_overrun_count(void) {
+	return read_count(&hardware_overrun_count);
+}
+
+uint16_t serial_framing_error_count(void) {
+	return read_count(&framing_error_count);
+}
+
+uint16_t serial_xoff_count(void) {
+	return read_count(&xoff_count);
+}
+
+/* Ask the UDRE ISR to send XON if input was stopped and the buffer has been
+ * read down far enough (or flow control has been turned off).
+ */
+static void check_restart_input(in_index_t tail) {
+	if(flow_stopped) {
+		in_index_t waiting = (read_input_head() - tail) & INPUT_BUFFER_MASK;
+		if(waiting <= SERIAL_XON_LEVEL || !flow_control) {
+			uint8_t sreg = SREG;
+			cli();
+			flow_stopped = 0;
+			flow_char = XON;
+			UCSR0B |= (1 << UDRIE0);
+			SREG = sreg;
+		}
+	}
+}
+
+void serial_set_flow_control(int8_t enabled) {
+	flow_control = enabled;
+	check_restart_input(input_tail);
+}
+
+int8_t serial_get_flow_control(void) {
+	return flow_control;
 }
 
 void clear_serial_input_buffer(void) {
-	/* Just adjust our buffer data so it looks empty */
-	input_insert_pos = 0;
-	bytes_in_input_buffer = 0;
+	/* Just consume everything that has been received so far */
+	in_index_t head = read_input_head();
+	write_input_tail(head);
+	check_restart_input(head);
 }
 
 static int uart_put_char(char c, FILE* stream) {
-	uint8_t interrupts_enabled;
-	
 	/* Add the character to the buffer for transmission (if there 
 	 * is space to do so). If not we wait until the buffer has space.
 	 * If the character is \n, we output \r (carriage return)
 	 * also.
 	*/
 	if(c == '\n') {
-		uart_put_char('\r', stream);
+		put_byte('\r');
 	}
-	
-	/* If the buffer is full and interrupts are disabled then we
-	 * abort - we don't output the character since the buffer will
-	 * never be emptied if interrupts are disabled. If the buffer is full
-	 * and interrupts are enabled then we loop until the buffer has 
-	 * enough space. The bytes_in_buffer variable will get modified by the
-	 * ISR which extracts bytes from the buffer.
-	*/
-	interrupts_enabled = bit_is_set(SREG, SREG_I);
-	while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
-		if(!interrupts_enabled) {
-			return 1;
-		}		
+	return put_byte(c);
+}
+
+void serial_write_raw(const uint8_t* data, uint8_t length) {
+	/* Binary data is queued as is - no newline translation */
+	put_block((const char*)data, length, 0);
+}
+
+void serial_set_tx_policy(SerialTxPolicy policy) {
+	tx_policy = policy;
+}
+
+SerialTxPolicy serial_get_tx_policy(void) {
+	return tx_policy;
+}
+
+uint16_t serial_tx_queued(void) {
+	return (out_index_t)(out_head - read_out_tail()) & OUTPUT_BUFFER_MASK;
+}
+
+uint16_t serial_tx_dropped_bytes(void) {
+	return tx_dropped_bytes;
+}
+
+uint16_t serial_tx_dropped_messages(void) {
+	return tx_dropped_messages;
+}
+
+int8_t serial_begin_message(uint8_t priority) {
+	if(tx_policy == SERIAL_TX_DROP_LOW_PRIORITY && priority == SERIAL_PRIORITY_LOW) {
+		/* Only accept the message if there is enough room that it
+		 * will probably fit, rather than producing it only to drop it.
+		 * (The buffer holds one byte less than its size.)
+		 */
+		if(OUTPUT_BUFFER_SIZE - 1 - serial_tx_queued() < SERIAL_LOW_PRIORITY_HEADROOM) {
+			tx_dropped_messages++;
+			message_state = MESSAGE_DROPPING;
+			return 0;
+		}
+		message_state = MESSAGE_NO_WAIT;
+	} else if(tx_policy == SERIAL_TX_DROP_NEWEST || bit_is_clear(SREG, SREG_I)) {
+		/* With interrupts off the buffer can't empty, so waiting isn't
+		 * possible either */
+		message_state = MESSAGE_NO_WAIT;
+	} else {
+		message_state = MESSAGE_NONE;
+	}
+	return 1;
+}
+
+int8_t serial_end_message(void) {
+	int8_t sent = (message_state != MESSAGE_DROPPING);
+	if(message_state == MESSAGE_NO_WAIT && out_fill != out_head) {
+		/* All of it fitted - let the ISR send it */
+		publish_output(out_fill);
+	}
+	message_state = MESSAGE_NONE;
+	return sent;
+}
+
+/* Return the free space in the output buffer, waiting for some if it is
+ * full. Returns 0 if output has to be discarded instead: if interrupts are
+ * disabled (the buffer would never be emptied) or the output policy says we
+ * mustn't wait. out_tail will get modified by the ISR which extracts bytes
+ * from the buffer. If we give up in the middle of a message, the part of
+ * it already stored is taken back out and the rest is discarded too.
+ */
+static out_index_t output_room(void) {
+	if(message_state == MESSAGE_DROPPING) {
+		return 0;
+	}
+	while(1) {
+		out_index_t room = (read_out_tail() - out_fill - 1) & OUTPUT_BUFFER_MASK;
+		if(room) {
+			return room;
+		}
+		if(bit_is_clear(SREG, SREG_I) || tx_policy == SERIAL_TX_DROP_NEWEST
+				|| message_state == MESSAGE_NO_WAIT) {
+			if(message_state != MESSAGE_NONE) {
+				tx_dropped_messages++;
+				tx_dropped_bytes += (out_index_t)(out_fill - out_head) & OUTPUT_BUFFER_MASK;
+				out_fill = out_head;
+				message_state = MESSAGE_DROPPING;
+			}
+			return 0;
+		}
 		/* else do nothing */
 	}
+}
+
+/* Tell the ISR about bytes stored up to (but not including) head. The
+ * ISR doesn't look at a slot until the head has moved past it, so no
+ * critical section is needed to fill the buffer.
+ */
+static void publish_output(out_index_t head) {
+	write_out_head(head);
 	
-	/* Add the character to the buffer for transmission if there
-	 * is space to do so. We advance the insert_pos to the next
-	 * character position. If this is beyond the end of the buffer
-	 * we wrap around back to the beginning of the buffer 
-	 * NOTE: we disable interrupts before modifying the buffer. This
-	 * prevents the ISR from modifying the buffer at the same time.
-	 * We reenable them if they were enabled when we entered the
-	 * function.
-	*/	
-	cli();
-	out_buffer[out_insert_pos++] = c;
-	bytes_in_out_buffer++;
-	if(out_insert_pos == OUTPUT_BUFFER_SIZE) {
-		/* Wrap around buffer pointer if necessary */
-		out_insert_pos = 0;
-	}
-	/* Reenable interrupts (UDR Empty interrupt may have been
-	 * disabled) - we ensure it is now enabled so that it will
-	 * fire and deal with the next character in the buffer. */
+	/* Make sure the UDR Empty interrupt is enabled so that it will
+	 * fire and deal with the next character in the buffer. (The ISR
+	 * only ever clears this bit, when it finds the buffer empty. If
+	 * it does that between our read and write of UCSR0B we set it
+	 * again, which just causes one more (empty) interrupt.) */
 	UCSR0B |= (1 << UDRIE0);
-	if(interrupts_enabled) {
-		sei();
+}
+
+/* Bytes have been stored up to out_fill - pass them on unless they are
+ * part of a message that is being held back until it is complete.
+ */
+static inline void output_stored(void) {
+	if(message_state != MESSAGE_NO_WAIT) {
+		publish_output(out_fill);
+	}
+}
+
+static int8_t put_byte(uint8_t c) {
+	if(!output_room()) {
+		tx_dropped_bytes++;
+		return 1;
 	}
+	out_buffer[out_fill] = c;
+	out_fill = (out_fill + 1) & OUTPUT_BUFFER_MASK;
+	output_stored();
 	return 0;
 }
 
+/* Copy a block of bytes (from RAM, or from program memory if in_progmem is
+ * set) to the output buffer. As much as fits is copied in one go and then
+ * published with a single update of the head, rather than a byte at a time.
+ */
+static void put_block(const char* data, uint8_t length, uint8_t in_progmem) {
+	while(length) {
+		out_index_t room = output_room();
+		if(!room) {
+			tx_dropped_bytes += length;
+			return;
+		}
+		uint8_t count = (room < length) ? room : length;
+		out_index_t head = out_fill;
+		length -= count;
+		if(in_progmem) {
+			while(count--) {
+				out_buffer[head] = pgm_read_byte(data++);
+				head = (head + 1) & OUTPUT_BUFFER_MASK;
+			}
+		} else {
+			while(count--) {
+				out_buffer[head] = *data++;
+				head = (head + 1) & OUTPUT_BUFFER_MASK;
+			}
+		}
+		out_fill = head;
+		output_stored();
+	}
+}
+
+void serial_write(const char* data, uint8_t length) {
+	put_block(data, length, 0);
+}
+
+void serial_write_P(const char* string) {
+	put_block(string, strlen_P(string), 1);
+}
+
+uint8_t serial_format_uint(char* buffer, uint16_t value) {
+	/* Produce the digits backwards and then reverse them */
+	uint8_t length = 0;
+	do {
+		buffer[length++] = '0' + value % 10;
+		value /= 10;
+	} while(value);
+	for(uint8_t i = 0; i < length / 2; i++) {
+		char digit = buffer[i];
+		buffer[i] = buffer[length - 1 - i];
+		buffer[length - 1 - i] = digit;
+	}
+	return length;
+}
+
+void serial_write_uint(uint16_t value) {
+	char digits[5];
+	put_block(digits, serial_format_uint(digits, value), 0);
+}
+
 int uart_get_char(FILE* stream) {
+	in_index_t tail = input_tail;
+	
 	/* Wait until we've received a character */
-	while(bytes_in_input_buffer == 0) {
+	while(read_input_head() == tail) {
 		/* do nothing */
 	}
 	
 	/*
-	 * Turn interrupts off and remove a character from the input
-	 * buffer. We reenable interrupts if they were on.
-	 * The pending character is the one which is byte_in_input_buffer
-	 * characters before the insert position (taking into account
-	 * that we may need to wrap around).
+	 * Take the character at the tail and then advance the tail,
+	 * which hands the slot back to the RX ISR.
 	 */
-	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
-	cli();
-	char c;
-	if(input_insert_pos - bytes_in_input_buffer < 0) {
-		/* Need to wrap around */
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer
-				+ INPUT_BUFFER_SIZE];
-	} else {
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer];
+	char c = input_buffer[tail];
+	tail = (tail + 1) & INPUT_BUFFER_MASK;
+	write_input_tail(tail);
+	check_restart_input(tail);
+	trace_event(TRACE_SERIAL_RX, c);
+
+	/* The work the RX ISR leaves to us: if the character is a carriage
+	 * return, turn it into a linefeed, and echo it if echoing is enabled
+	 */
+	if (c == '\r') {
+		c = '\n';
+	}
+	if (do_echo) {
+		uart_put_char(c, stream);
 	}
-	
-	/* Decrement our count of bytes in the input buffer */
-	bytes_in_input_buffer--;
-	if(interrupts_enabled) {
-		sei();
-	}	
 	return c;
 }
 
@@ -219,29 +658,20 @@ int uart_get_char(FILE* stream) {
  */
 ISR(USART0_UDRE_vect) 
 {
-	/* Check if we have data in our buffer */
-	if(bytes_in_out_buffer > 0) {
-		/* Yes we do - remove the pending byte and output it
-		 * via the UART. The pending byte (character) is the
-		 * one which is "bytes_in_buffer" characters before the 
-		 * insert_pos (taking into account that we may 
-		 * need to wrap around to the end of the buffer).
-		 */
-		char c;
-		if(out_insert_pos - bytes_in_out_buffer < 0) {
-			/* Need to wrap around */
-			c = out_buffer[out_insert_pos - bytes_in_out_buffer
-				+ OUTPUT_BUFFER_SIZE];
-		} else {
-			c = out_buffer[out_insert_pos - bytes_in_out_buffer];
-		}
-		/* Decrement our count of the number of bytes in the 
-		 * buffer 
+	PROFILE_ENTER();
+	out_index_t tail = out_tail;
+	
+	/* Flow control characters go ahead of everything else */
+	if(flow_char) {
+		UDR0 = flow_char;
+		flow_char = 0;
+	} else if(tail != out_head) {
+		/* Check if we have data in our buffer */
+		/* Yes we do - output the byte at the tail via the
+		 * UART and advance the tail.
 		 */
-		bytes_in_out_buffer--;
-		
-		/* Output the character via the UART */
-		UDR0 = c;
+		UDR0 = out_buffer[tail];
+		out_tail = (tail + 1) & OUTPUT_BUFFER_MASK;
 	} else {
 		/* No data in the buffer. We disable the UART Data
 		 * Register Empty interrupt because otherwise it 
@@ -250,7 +680,13 @@ ISR(USART0_UDRE_vect)
 		 * placed in the buffer.
 		 */
 		UCSR0B &= ~(1<<UDRIE0);
+		/* Clear TXC (by writing a 1 to it) so serial_set_baud() can
+		 * tell when the last byte has been sent. The other flags in
+		 * UCSR0A must be written as 0, apart from U2X.
+		 */
+		UCSR0A = (UCSR0A & (1 << U2X0)) | (1 << TXC0);
 	}
+	PROFILE_EXIT(PROFILE_SERIAL_UDRE);
 }
 
 /*
@@ -261,45 +697,55 @@ ISR(USART0_UDRE_vect)
 
 ISR(USART0_RX_vect) 
 {
-	/* Read the character - we ignore the possibility of overrun. */
+	/* This handler only stores the character. Echoing and carriage
+	 * return translation are done when the character is read (see
+	 * uart_get_char()), and it calls no functions, so it doesn't have
+	 * to save every register. This keeps it short enough that a stream
+	 * of input can't hold up the timer 0 tick.
+	 */
+	PROFILE_ENTER();
+
+	/* Read the character. The error flags are for this character so
+	 * they must be read before UDR0. A framing error means the
+	 * character is garbage, so it is thrown away. An overrun means
+	 * characters before this one were lost.
+	 */
+	uint8_t status = UCSR0A;
 	char c;
 	c = UDR0;
-		
-	if(do_echo && bytes_in_out_buffer < OUTPUT_BUFFER_SIZE) {
-		/* If echoing is enabled and there is output buffer
-		 * space, echo the received character back to the UART.
-		 * (If there is no output buffer space, characters
-		 * will be lost.)
-		 */
-		uart_put_char(c, 0);
+	if(status & (1 << DOR0)) {
+		hardware_overrun_count++;
 	}
 	
 	/* 
-	 * Check if we have space in our buffer. If not, set the overrun
-	 * flag and throw away the character. (We never clear the 
-	 * overrun flag - it's up to the programmer to check/clear
-	 * this flag if desired.)
+	 * Check if we have space in our buffer. If not, count the overrun
+	 * and throw away the character. (The count can be read with
+	 * serial_input_overrun_count().)
 	 */
-	if(bytes_in_input_buffer >= INPUT_BUFFER_SIZE) {
-		input_overrun = 1;
+	in_index_t head = input_head;
+	in_index_t next = (head + 1) & INPUT_BUFFER_MASK;
+	if(status & (1 << FE0)) {
+		framing_error_count++;
+	} else if(next == input_tail) {
+		input_overrun_count++;
 	} else {
-		/* If the character is a carriage return, turn it into a
-		 * linefeed 
-		*/
-		if (c == '\r') {
-			c = '\n';
-		}
-		
 		/* 
 		 * There is room in the input buffer 
 		 */
-		input_buffer[input_insert_pos++] = c;
-		bytes_in_input_buffer++;
-		if(input_insert_pos == INPUT_BUFFER_SIZE) {
-			/* Wrap around buffer pointer if necessary */
-			input_insert_pos = 0;
+		input_buffer[head] = c;
+		input_head = next;
+
+		/* Ask the sender to stop if the buffer is filling up */
+		if(flow_control && !flow_stopped
+				&& ((next - input_tail) & INPUT_BUFFER_MASK) >= SERIAL_XOFF_LEVEL) {
+			flow_stopped = 1;
+			flow_char = XOFF;
+			xoff_count++;
+			UCSR0B |= (1 << UDRIE0);
 		}
 	}
+
+	PROFILE_EXIT(PROFILE_SERIAL_RX);
 }
 
 
@@ -20,11 +20,51 @@
 
 /* Initialise serial IO using the UART. baudrate specifies the desired
  * baud rate (e.g. 19200) and echo determines whether incoming characters
- * are echoed back to the UART output as they are received (zero means no
- * echo, non-zero means echo)
+ * are echoed back to the UART output as they are read (zero means no
+ * echo, non-zero means echo). The UART is set to whichever of normal and
+ * double speed (U2X) mode gives the rate closest to baudrate - check the
+ * rate with SERIAL_BAUD_OK() first.
  */
 void init_serial_stdio(long baudrate, int8_t echo);
 
+/* Baud rates are generated by dividing the system clock (F_CPU), so only
+ * some rates can be made accurately. A rate is usable if it is within
+ * SERIAL_MAX_BAUD_ERROR tenths of a percent (i.e. 2%) of the rate asked
+ * for in either normal (16 clocks per bit) or double speed (8 clocks per
+ * bit) mode. With an 8MHz clock 9600, 19200, 38400, 76800, 250000, 500000
+ * and 1000000 are all exact to within 0.2%. 57600 (2.1%) and 115200
+ * (3.5%) are not usable.
+ * SERIAL_BAUD_OK() can be used in #if to check a rate at compile time (F_CPU
+ * must be defined). A rate that is far too high gives a division by zero.
+ */
+#define SERIAL_MAX_BAUD_ERROR 20
+#define SERIAL_UBRR(baud, u2x) \
+	((F_CPU + (8L >> (u2x)) * (baud)) / ((16L >> (u2x)) * (baud)) - 1)
+#define SERIAL_ACTUAL_BAUD(baud, u2x) \
+	(F_CPU / ((16L >> (u2x)) * (SERIAL_UBRR(baud, u2x) + 1)))
+#define SERIAL_BAUD_ERROR(baud, u2x) \
+	((SERIAL_ACTUAL_BAUD(baud, u2x) > (baud) ? \
+		SERIAL_ACTUAL_BAUD(baud, u2x) - (baud) : \
+		(baud) - SERIAL_ACTUAL_BAUD(baud, u2x)) * 1000 / (baud))
+#define SERIAL_BAUD_OK(baud) \
+	(SERIAL_BAUD_ERROR(baud, 0) <= SERIAL_MAX_BAUD_ERROR \
+		|| SERIAL_BAUD_ERROR(baud, 1) <= SERIAL_MAX_BAUD_ERROR)
+
+/* Return the error (in tenths of a percent) of the closest rate to
+ * baudrate that the UART can generate.
+ */
+uint16_t serial_baud_error(uint32_t baudrate);
+
+/* Change the baud rate. Everything already queued for output is sent at
+ * the old rate first. Returns 0 (and leaves the rate alone) if the rate
+ * isn't usable (see above) or interrupts are disabled (so the output
+ * can't be sent).
+ */
+int8_t serial_set_baud(uint32_t baudrate);
+
+/* Return the baud rate that was last asked for. */
+uint32_t serial_get_baud(void);
+
 /* Test if input is available from the serial port. Return 0 if not,
  * non-zero otherwise. If there is input available then it can be read
  * with a suitable standard IO library function, e.g. fgetc().
@@ -36,4 +76,95 @@ int8_t serial_input_available(void);
  */
 void clear_serial_input_buffer(void);
 
+/* Return the number of incoming characters that have been discarded
+ * because the input buffer was full (since init_serial_stdio() was called).
+ */
+uint16_t serial_input_overrun_count(void);
+
+/* Return the number of characters lost because the UART received another
+ * character before the last one had been read (hardware overrun), and the
+ * number thrown away because they had framing errors (usually a baud rate
+ * mismatch or line noise), since init_serial_stdio() was called.
+ */
+uint16_t serial_hardware_overrun_count(void);
+uint16_t serial_framing_error_count(void);
+
+/* Turn XON/XOFF flow control of the input on (non-zero) or off (the
+ * default). When on, XOFF is sent when the input buffer is half full and
+ * XON once it has been read back down to a quarter full, so a sender that
+ * honours XON/XOFF can stream input without overrunning the buffer.
+ * (XON/XOFF characters received are not treated specially.)
+ * serial_xoff_count() returns the number of times XOFF has been sent.
+ */
+void serial_set_flow_control(int8_t enabled);
+int8_t serial_get_flow_control(void);
+uint16_t serial_xoff_count(void);
+
+/* Queue length bytes of binary data for output. Unlike stdio output there
+ * is no newline translation. (What happens if the output buffer is full
+ * depends on the output policy, in the same way as the stdio functions.)
+ */
+void serial_write_raw(const uint8_t* data, uint8_t length);
+
+/* Fast output paths that bypass stdio. The bytes are copied straight into
+ * the output buffer (as many as fit at a time) - there is no formatting and
+ * no newline translation. serial_write() copies length bytes from RAM,
+ * serial_write_P() copies a null terminated string from program memory
+ * (e.g. serial_write_P(PSTR("text"))) and serial_write_uint() writes an
+ * unsigned number in decimal.
+ */
+void serial_write(const char* data, uint8_t length);
+void serial_write_P(const char* string);
+void serial_write_uint(uint16_t value);
+
+/* Write value in decimal to buffer (which must have room for 5 characters).
+ * No null terminator is added. Returns the number of characters written.
+ */
+uint8_t serial_format_uint(char* buffer, uint16_t value);
+
+/* What happens when output doesn't fit in the output buffer:
+ * SERIAL_TX_BLOCK - wait until there is room (the default when
+ *     interrupts are enabled).
+ * SERIAL_TX_DROP_NEWEST - never wait, discard the output that doesn't fit.
+ * SERIAL_TX_DROP_LOW_PRIORITY - low priority messages (see
+ *     serial_begin_message()) are discarded unless there are at least
+ *     SERIAL_LOW_PRIORITY_HEADROOM bytes free, and never wait. All other
+ *     output waits for room.
+ * If interrupts are disabled, output that doesn't fit is always discarded.
+ */
+typedef enum {
+	SERIAL_TX_BLOCK = 0,
+	SERIAL_TX_DROP_NEWEST = 1,
+	SERIAL_TX_DROP_LOW_PRIORITY = 2
+} SerialTxPolicy;
+
+#define SERIAL_PRIORITY_LOW 0
+#define SERIAL_PRIORITY_HIGH 1
+#define SERIAL_LOW_PRIORITY_HEADROOM 64
+
+void serial_set_tx_policy(SerialTxPolicy policy);
+SerialTxPolicy serial_get_tx_policy(void);
+
+/* Mark the start of a message - output that should be sent whole or not at
+ * all, such as a cursor movement and the text that follows it. Returns 0 if
+ * the message has been dropped (under the current policy), in which case
+ * any output up to serial_end_message() is discarded, so the caller can
+ * skip producing it. A message that mustn't wait for room is held back
+ * from the serial port until serial_end_message(). If it turns out not to
+ * fit, none of it is sent (it must fit in the output buffer on its own).
+ * Messages can't be nested. serial_end_message() returns non-zero if the
+ * whole message was queued.
+ */
+int8_t serial_begin_message(uint8_t priority);
+int8_t serial_end_message(void);
+
+/* Return the number of bytes waiting in the output buffer. */
+uint16_t serial_tx_queued(void);
+
+/* Return the number of output bytes and messages discarded because the
+ * output buffer was full (since init_serial_stdio() was called).
+ */
+uint16_t serial_tx_dropped_bytes(void);
+uint16_t serial_tx_dropped_messages(void);
+
 #endif /* SERIALIO_H_ */
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+ * splash_assets.c
+ *
+ * Generated by tools/gen_assets.py from tools/splash.txt - do not edit.
+ * Run the generator again after changing the images.
+ */
+
+#include "splash_assets.h"
+
+const uint8_t splash_payload[467] PROGMEM = {
+	// Step 0 (119 bytes)
+	0x0F, 0x03, 0x00, 0x0F, 0x0F, 0x0F, 0x00, 0x00, 0x0F, 0x0F, 0x0F, 0x01,
+	0x01, 0x0F, 0x01, 0x51, 0x0F, 0x03, 0x02, 0x0F, 0x0F, 0x0F, 0x00, 0x00,
+	0x0F, 0x0F, 0x0F, 0x01, 0x03, 0x0F, 0x01, 0x53, 0x0F, 0x03, 0x04, 0x0F,
+	0x0F, 0x0F, 0x00, 0x00, 0x0F, 0x0F, 0x0F, 0x03, 0x06, 0xF0, 0xF0, 0xF0,
+	0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0x03, 0x07, 0xF0, 0xF0, 0x00, 0x00, 0x00,
+	0x00, 0xF0, 0xF0, 0x03, 0x08, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+	0xF0, 0x01, 0x09, 0xF0, 0x01, 0x79, 0xF0, 0x01, 0x0A, 0xF0, 0x01, 0x7A,
+	0xF0, 0x01, 0x0B, 0xF0, 0x01, 0x7B, 0xF0, 0x01, 0x0C, 0xF0, 0x01, 0x7C,
+	0xF0, 0x01, 0x0D, 0xF0, 0x01, 0x7D, 0xF0, 0x01, 0x0E, 0xF0, 0x01, 0x7E,
+	0xF0, 0x03, 0x0F, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+	// Step 1 (36 bytes)
+	0x01, 0x39, 0xF0, 0x01, 0x49, 0xF0, 0x01, 0x3A, 0xF0, 0x01, 0x4A, 0xF0,
+	0x01, 0x3B, 0xF0, 0x01, 0x4B, 0xF0, 0x01, 0x3C, 0xF0, 0x01, 0x4C, 0xF0,
+	0x01, 0x3D, 0xF0, 0x01, 0x4D, 0xF0, 0x01, 0x3E, 0xF0, 0x01, 0x4E, 0xF0,
+	// Step 2 (60 bytes)
+	0x03, 0x09, 0xF0, 0x00, 0xF0, 0x00, 0x00, 0xF0, 0x00, 0xF0, 0x03, 0x0A,
+	0xF0, 0x00, 0xF0, 0x00, 0x00, 0xF0, 0x00, 0xF0, 0x03, 0x0B, 0xF0, 0x00,
+	0xF0, 0x00, 0x00, 0xF0, 0x00, 0xF0, 0x03, 0x0C, 0xF0, 0x00, 0xF0, 0x00,
+	0x00, 0xF0, 0x00, 0xF0, 0x03, 0x0D, 0xF0, 0x00, 0xF0, 0x00, 0x00, 0xF0,
+	0x00, 0xF0, 0x03, 0x0E, 0xF0, 0x00, 0xF0, 0x00, 0x00, 0xF0, 0x00, 0xF0,
+	// Step 3 (60 bytes)
+	0x03, 0x09, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0x03, 0x0A,
+	0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0x03, 0x0B, 0xF0, 0xF0,
+	0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0, 0x03, 0x0C, 0xF0, 0xF0, 0x00, 0x00,
+	0x00, 0x00, 0xF0, 0xF0, 0x03, 0x0D, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00,
+	0xF0, 0xF0, 0x03, 0x0E, 0xF0, 0xF0, 0x00, 0x00, 0x00, 0x00, 0xF0, 0xF0,
+	// Step 4 (36 bytes)
+	0x01, 0x19, 0x00, 0x01, 0x69, 0x00, 0x01, 0x1A, 0x00, 0x01, 0x6A, 0x00,
+	0x01, 0x1B, 0x00, 0x01, 0x6B, 0x00, 0x01, 0x1C, 0x00, 0x01, 0x6C, 0x00,
+	0x01, 0x1D, 0x00, 0x01, 0x6D, 0x00, 0x01, 0x1E, 0x00, 0x01, 0x6E, 0x00,
+	// Step 5 (36 bytes)
+	0x01, 0x19, 0xF0, 0x01, 0x69, 0xF0, 0x01, 0x1A, 0xF0, 0x01, 0x6A, 0xF0,
+	0x01, 0x1B, 0xF0, 0x01, 0x6B, 0xF0, 0x01, 0x1C, 0xF0, 0x01, 0x6C, 0xF0,
+	0x01, 0x1D, 0xF0, 0x01, 0x6D, 0xF0, 0x01, 0x1E, 0xF0, 0x01, 0x6E, 0xF0,
+	// Step 6 (60 bytes)
+	0x03, 0x09, 0xF0, 0x00, 0xF0, 0x00, 0x00, 0xF0, 0x00, 0xF0, 0x03, 0x0A,
+	0xF0, 0x00, 0xF0, 0x00, 0x00, 0xF0, 0x00, 0xF0, 0x03, 0x0B, 0xF0, 0x00,
+	0xF0, 0x00, 0x00, 0xF0, 0x00, 0xF0, 0x03, 0x0C, 0xF0, 0x00, 0xF0, 0x00,
+	0x00, 0xF0, 0x00, 0xF0, 0x03, 0x0D, 0xF0, 0x00, 0xF0, 0x00, 0x00, 0xF0,
+	0x00, 0xF0, 0x03, 0x0E, 0xF0, 0x00, 0xF0, 0x00, 0x00, 0xF0, 0x00, 0xF0,
+	// Step 7 (60 bytes)
+	0x03, 0x09, 0xF0, 0x00, 0x00, 0xF0, 0xF0, 0x00, 0x00, 0xF0, 0x03, 0x0A,
+	0xF0, 0x00, 0x00, 0xF0, 0xF0, 0x00, 0x00, 0xF0, 0x03, 0x0B, 0xF0, 0x00,
+	0x00, 0xF0, 0xF0, 0x00, 0x00, 0xF0, 0x03, 0x0C, 0xF0, 0x00, 0x00, 0xF0,
+	0xF0, 0x00, 0x00, 0xF0, 0x03, 0x0D, 0xF0, 0x00, 0x00, 0xF0, 0xF0, 0x00,
+	0x00, 0xF0, 0x03, 0x0E, 0xF0, 0x00, 0x00, 0xF0, 0xF0, 0x00, 0x00, 0xF0,
+};
+
+const uint16_t splash_steps[SPLASH_NUM_STEPS][3] PROGMEM = {
+	{0, 119, 150},
+	{119, 36, 2000},
+	{155, 60, 150},
+	{215, 60, 150},
+	{275, 36, 500},
+	{311, 36, 150},
+	{347, 60, 150},
+	{407, 60, 2000}
+};
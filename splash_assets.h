@@ -0,0 +1,23 @@
+/*
+ * splash_assets.h
+ *
+ * Generated by tools/gen_assets.py from tools/splash.txt - do not edit.
+ * Run the generator again after changing the images.
+ */
+
+#ifndef SPLASH_ASSETS_H_
+#define SPLASH_ASSETS_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define SPLASH_NUM_STEPS 8
+// Step to carry on from after the last (SPLASH_NUM_STEPS to stop)
+#define SPLASH_LOOP_STEP 2
+
+// LED matrix commands for all of the steps
+extern const uint8_t splash_payload[467] PROGMEM;
+// For each step: offset and length in splash_payload, ms to show it for
+extern const uint16_t splash_steps[SPLASH_NUM_STEPS][3] PROGMEM;
+
+#endif /* SPLASH_ASSETS_H_ */
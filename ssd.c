@@ -0,0 +1,202 @@
+/*
+ * ssd.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See ssd.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "ssd.h"
+#include "profile.h"
+
+// Port masks for a glyph from the segments (a to g) that are lit
+#define SEGMENTS(a, b, c, d, e, f, g) { \
+		((a) << SSD_A) | ((d) << SSD_D) | ((g) << SSD_G), \
+		((b) << SSD_B) | ((c) << SSD_C) | ((e) << SSD_E) | ((f) << SSD_F) }
+
+typedef struct {
+	uint8_t portc;
+	uint8_t portd;
+} GlyphMasks;
+
+// In SsdGlyph order
+static const GlyphMasks glyphs[SSD_NUM_GLYPHS] PROGMEM = {
+	//        a  b  c  d  e  f  g
+	SEGMENTS(1, 1, 1, 1, 1, 1, 0),	// 0
+	SEGMENTS(0, 1, 1, 0, 0, 0, 0),	// 1
+	SEGMENTS(1, 1, 0, 1, 1, 0, 1),	// 2
+	SEGMENTS(1, 1, 1, 1, 0, 0, 1),	// 3
+	SEGMENTS(0, 1, 1, 0, 0, 1, 1),	// 4
+	SEGMENTS(1, 0, 1, 1, 0, 1, 1),	// 5
+	SEGMENTS(1, 0, 1, 1, 1, 1, 1),	// 6
+	SEGMENTS(1, 1, 1, 0, 0, 0, 0),	// 7
+	SEGMENTS(1, 1, 1, 1, 1, 1, 1),	// 8
+	SEGMENTS(1, 1, 1, 1, 0, 1, 1),	// 9
+	SEGMENTS(1, 1, 1, 0, 1, 1, 1),	// A
+	SEGMENTS(0, 0, 1, 1, 1, 1, 1),	// b
+	SEGMENTS(1, 0, 0, 1, 1, 1, 0),	// C
+	SEGMENTS(0, 1, 1, 1, 1, 0, 1),	// d
+	SEGMENTS(1, 0, 0, 1, 1, 1, 1),	// E
+	SEGMENTS(1, 0, 0, 0, 1, 1, 1),	// F
+	SEGMENTS(1, 0, 0, 0, 0, 0, 0),	// Up
+	SEGMENTS(0, 0, 0, 1, 0, 0, 0),	// Down
+	SEGMENTS(0, 0, 0, 0, 0, 0, 1),	// Stopped
+	SEGMENTS(0, 0, 0, 0, 0, 0, 0),	// Blank
+	SEGMENTS(0, 0, 0, 0, 1, 0, 1),	// r
+	SEGMENTS(0, 1, 1, 0, 1, 1, 1),	// H
+	SEGMENTS(0, 0, 0, 1, 1, 1, 0),	// L
+	SEGMENTS(1, 1, 0, 0, 1, 1, 1)	// P
+};
+
+// The digit select and decimal point for each digit - the left digit is
+// selected by CC being high, the right has its decimal point lit
+static const uint8_t digit_select[2] = {
+	(1 << SSD_CC),
+	(1 << SSD_DP)
+};
+
+// Timer 0 count (out of 125 per ms) at which a digit is lit, for each
+// brightness level. The digit stays lit until the next tick, so level 1 is
+// lit for 16us and the top level for 117 counts (936us); the steps are
+// roughly even to the eye. Counts after the end of the timer 0 handler's
+// work give an exact on time however long that work takes (its longest run
+// is the timer0 slot's max in "profile", at 64 cycles a count). Only the
+// top level's count is early enough to fall inside it, and then the digit
+// is just lit a little late. At level 0 there is nothing to light (see
+// update_digits()).
+// The count must stay below OCR0A (124), or the compare B interrupt would
+// be taken after the next tick's and light the digit for a whole tick.
+static const uint8_t light_counts[SSD_BRIGHTNESS_MAX + 1] PROGMEM = {
+	123, 122, 119, 114, 106, 94, 76, 49, 7
+};
+
+static SsdMode modes[2];
+static uint8_t brightness;
+static uint8_t shown_digit;
+static uint8_t fault;
+// Glyph shown in each mode (the fixed glyph is per digit)
+static SsdGlyph mode_glyphs[SSD_NUM_MODES];
+static SsdGlyph fixed_glyphs[2];
+
+// What the compare B interrupt writes for each digit
+static volatile uint8_t digit_portc[2];
+static volatile uint8_t digit_portd[2];
+
+// Work out the port values for both digits. When the display is off the
+// segments and decimal point are left out (only the digit select is kept),
+// so the compare B interrupt doesn't need to check.
+static void update_digits(void) {
+	for (uint8_t digit = SSD_LEFT; digit <= SSD_RIGHT; digit++) {
+		uint8_t portc = digit_select[digit] & (1 << SSD_CC);
+		uint8_t portd = 0;
+		if (brightness != 0) {
+			SsdGlyph glyph = modes[digit] == SSD_MODE_GLYPH ? fixed_glyphs[digit] : mode_glyphs[modes[digit]];
+			portc = pgm_read_byte(&glyphs[glyph].portc) | digit_select[digit];
+			portd = pgm_read_byte(&glyphs[glyph].portd);
+		}
+		// Both bytes must change together as far as the interrupt can see
+		uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+		cli();
+		digit_portc[digit] = portc;
+		digit_portd[digit] = portd;
+		if (interrupts_were_enabled) {
+			sei();
+		}
+	}
+}
+
+void init_ssd(void) {
+	DDRC |= SSD_PORTC_MASK;
+	DDRD |= SSD_PORTD_MASK;
+	PORTC &= ~SSD_PORTC_MASK;
+	PORTD &= ~SSD_PORTD_MASK;
+
+	modes[SSD_LEFT] = SSD_MODE_DIRECTION;
+	modes[SSD_RIGHT] = SSD_MODE_FLOOR;
+	mode_glyphs[SSD_MODE_FLOOR] = SSD_GLYPH_0;
+	mode_glyphs[SSD_MODE_DIRECTION] = SSD_GLYPH_STOPPED;
+	mode_glyphs[SSD_MODE_QUEUE] = SSD_GLYPH_0;
+	mode_glyphs[SSD_MODE_FAULT] = SSD_GLYPH_BLANK;
+	mode_glyphs[SSD_MODE_GLYPH] = SSD_GLYPH_BLANK; // Unused
+	mode_glyphs[SSD_MODE_BLANK] = SSD_GLYPH_BLANK;
+	fixed_glyphs[SSD_LEFT] = SSD_GLYPH_BLANK;
+	fixed_glyphs[SSD_RIGHT] = SSD_GLYPH_BLANK;
+	fault = SSD_FAULT_NONE;
+	ssd_set_brightness(SSD_BRIGHTNESS_DEFAULT);
+
+	// Light the digits part way through each timer 0 tick
+	TIFR0 = (1 << OCF0B);
+	TIMSK0 |= (1 << OCIE0B);
+}
+
+void ssd_set_brightness(uint8_t level) {
+	if (level > SSD_BRIGHTNESS_MAX) {
+		level = SSD_BRIGHTNESS_MAX;
+	}
+	brightness = level;
+	OCR0B = pgm_read_byte(&light_counts[level]);
+	update_digits();
+}
+
+uint8_t ssd_get_brightness(void) {
+	return brightness;
+}
+
+void ssd_set_mode(SsdDigit digit, SsdMode mode) {
+	modes[digit] = mode;
+	update_digits();
+}
+
+SsdMode ssd_get_mode(SsdDigit digit) {
+	return modes[digit];
+}
+
+void ssd_set_floor(uint8_t floor) {
+	mode_glyphs[SSD_MODE_FLOOR] = (SsdGlyph)(floor & 0x0F);
+	update_digits();
+}
+
+void ssd_set_direction(SsdGlyph arrow) {
+	mode_glyphs[SSD_MODE_DIRECTION] = arrow;
+	update_digits();
+}
+
+void ssd_set_queue(uint8_t count) {
+	mode_glyphs[SSD_MODE_QUEUE] = (SsdGlyph)(count > 15 ? 15 : count);
+	update_digits();
+}
+
+void ssd_set_fault(uint8_t code) {
+	fault = code;
+	mode_glyphs[SSD_MODE_FAULT] = code == SSD_FAULT_NONE ? SSD_GLYPH_BLANK : (SsdGlyph)(code & 0x0F);
+	update_digits();
+}
+
+uint8_t ssd_get_fault(void) {
+	return fault;
+}
+
+void ssd_set_glyph(SsdDigit digit, SsdGlyph glyph) {
+	fixed_glyphs[digit] = glyph;
+	update_digits();
+}
+
+void ssd_tick(void) {
+	// Blank the segments and select the next digit, ready to be lit
+	uint8_t digit = shown_digit ^ 1;
+	shown_digit = digit;
+	PORTD &= ~SSD_PORTD_MASK;
+	PORTC = (PORTC & ~SSD_PORTC_MASK) | (digit_portc[digit] & (1 << SSD_CC));
+}
+
+// Light the segments of the selected digit
+ISR(TIMER0_COMPB_vect) {
+	PROFILE_ENTER();
+	uint8_t digit = shown_digit;
+	PORTC = (PORTC & ~SSD_PORTC_MASK) | digit_portc[digit];
+	PORTD = (PORTD & ~SSD_PORTD_MASK) | digit_portd[digit];
+	PROFILE_EXIT(PROFILE_SSD_LIGHT);
+}
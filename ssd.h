@@ -0,0 +1,125 @@
+/*
+ * ssd.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Two digit seven segment display. The segments are split across ports C
+ * and D, so each glyph is stored (in program memory) as the pair of port
+ * masks that light it. Each digit is given a mode saying what it shows -
+ * the floor, the direction of travel, the number of waiting travellers, a
+ * fault code or a fixed glyph. Whenever a value or mode changes the port
+ * masks for both digits are worked out again, so showing a digit is just
+ * two masked port writes.
+ *
+ * Only one digit can be lit at a time (they share the segment pins), so
+ * the digits are lit in turn from the 1ms timer 0 tick (ssd_tick()),
+ * independent of how busy the main program is. Each digit is selected,
+ * with its segments off, at the start of a tick and lit part way through
+ * it by the timer 0 compare B interrupt, so the brightness is set by how
+ * long it stays lit until the next tick. Lighting late in the tick (rather
+ * than blanking early) keeps the short on times of the dim levels clear of
+ * the rest of the tick's work, which would otherwise hold off the compare
+ * B interrupt. The segments are always off when the digit select changes,
+ * so nothing of one digit shows on the other.
+ */
+
+#ifndef SSD_H_
+#define SSD_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+// Segment pins
+#define SSD_A PC4
+#define SSD_B PD2
+#define SSD_C PD3
+#define SSD_D PC5
+#define SSD_E PD5
+#define SSD_F PD4
+#define SSD_G PC6
+// Digit select (high for the left digit) and decimal point, both port C
+#define SSD_CC PC1
+#define SSD_DP PC0
+
+// Brightness levels (0 is off)
+#define SSD_BRIGHTNESS_MAX 8
+#ifndef SSD_BRIGHTNESS_DEFAULT
+#define SSD_BRIGHTNESS_DEFAULT SSD_BRIGHTNESS_MAX
+#endif
+
+// All of the display's pins on each port
+#define SSD_PORTC_MASK ((1 << SSD_A) | (1 << SSD_D) | (1 << SSD_G) | (1 << SSD_CC) | (1 << SSD_DP))
+#define SSD_PORTD_MASK ((1 << SSD_B) | (1 << SSD_C) | (1 << SSD_E) | (1 << SSD_F))
+
+typedef enum {
+	SSD_LEFT = 0,
+	SSD_RIGHT = 1
+} SsdDigit;
+
+typedef enum {
+	SSD_MODE_FLOOR = 0,		// Floor the elevator is at
+	SSD_MODE_DIRECTION,		// Arrow for the direction of travel
+	SSD_MODE_QUEUE,			// Number of travellers waiting (hex)
+	SSD_MODE_FAULT,			// Fault code (hex), blank if none
+	SSD_MODE_GLYPH,			// Glyph set with ssd_set_glyph()
+	SSD_MODE_BLANK,
+	SSD_NUM_MODES
+} SsdMode;
+
+// Glyphs - 0 to 15 are the hex digits
+typedef enum {
+	SSD_GLYPH_0 = 0,
+	SSD_GLYPH_A = 10,
+	SSD_GLYPH_B,			// b
+	SSD_GLYPH_C,
+	SSD_GLYPH_D,			// d
+	SSD_GLYPH_E,
+	SSD_GLYPH_F,
+	SSD_GLYPH_UP,			// Top segment
+	SSD_GLYPH_DOWN,			// Bottom segment
+	SSD_GLYPH_STOPPED,		// Middle segment
+	SSD_GLYPH_BLANK,
+	SSD_GLYPH_LOWER_R,		// r, for "Er"
+	SSD_GLYPH_H,
+	SSD_GLYPH_L,
+	SSD_GLYPH_P,
+	SSD_NUM_GLYPHS
+} SsdGlyph;
+
+// Fault codes
+#define SSD_FAULT_NONE 0
+#define SSD_FAULT_INPUT_OVERRUN 1	// Button or serial input lost
+#define SSD_FAULT_QUEUE_FULL 2		// Traveller turned away
+
+/* Make the display pins outputs and show the direction on the left digit
+ * and the floor on the right, at the default brightness. The display is
+ * lit once timer 0 is running (see init_timer0()).
+ */
+void init_ssd(void);
+
+/* Blank the display and select the next digit, to be lit later in the
+ * tick. Must be called every millisecond, first thing in the timer 0
+ * interrupt handler.
+ */
+void ssd_tick(void);
+
+/* Set the brightness (0 to SSD_BRIGHTNESS_MAX). */
+void ssd_set_brightness(uint8_t level);
+uint8_t ssd_get_brightness(void);
+
+/* Choose what a digit shows. */
+void ssd_set_mode(SsdDigit digit, SsdMode mode);
+SsdMode ssd_get_mode(SsdDigit digit);
+
+/* Set the values shown by the digits in each mode. */
+void ssd_set_floor(uint8_t floor);
+void ssd_set_direction(SsdGlyph arrow);		// SSD_GLYPH_UP, _DOWN or _STOPPED
+void ssd_set_queue(uint8_t count);			// Shown as F if over 15
+void ssd_set_fault(uint8_t code);
+void ssd_set_glyph(SsdDigit digit, SsdGlyph glyph);
+
+/* Return the fault code last set. */
+uint8_t ssd_get_fault(void);
+
+
+#endif /* SSD_H_ */
@@ -0,0 +1,80 @@
+/*
+ * telemetry.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See telemetry.h for the record format.
+ */
+
+#include <stdint.h>
+#include <util/crc16.h>
+
+#include "telemetry.h"
+#include "serialio.h"
+
+// Raw record: type, sequence number, payload and CRC
+#define RECORD_SIZE (TELEMETRY_MAX_PAYLOAD + 3)
+// COBS adds one byte (records are always shorter than 254 bytes) and
+// then there is the delimiter
+#define FRAME_SIZE (RECORD_SIZE + 2)
+
+uint8_t telemetry_binary_mode;
+static uint8_t sequence;
+
+void telemetry_set_binary(uint8_t binary) {
+	telemetry_binary_mode = binary;
+}
+
+void telemetry_send(TelemetryRecord type, const uint8_t* payload, uint8_t length) {
+	uint8_t frame[FRAME_SIZE];
+	uint8_t crc;
+	uint8_t code_pos, out, code;
+
+	if (!telemetry_binary_mode || length > TELEMETRY_MAX_PAYLOAD) {
+		return;
+	}
+
+	// COBS encode the record as we go. frame[code_pos] is where the
+	// current block's code byte (distance to the next zero) will go.
+	code_pos = 0;
+	out = 1;
+	code = 1;
+	crc = 0;
+	for (uint8_t i = 0; i < length + 3; i++) {
+		uint8_t byte;
+		if (i == 0) {
+			byte = type;
+		} else if (i == 1) {
+			byte = sequence;
+		} else if (i < length + 2) {
+			byte = payload[i - 2];
+		} else {
+			byte = crc;
+		}
+		crc = _crc8_ccitt_update(crc, byte);
+
+		if (byte == 0) {
+			frame[code_pos] = code;
+			code_pos = out++;
+			code = 1;
+		} else {
+			frame[out++] = byte;
+			code++;
+		}
+	}
+	frame[code_pos] = code;
+	frame[out++] = 0; // Delimiter
+
+	sequence++;
+
+	// Replies and trace dumps are asked for, so they must get through.
+	// Status records can be dropped if the output buffer is busy (the
+	// host sees the gap in the sequence numbers).
+	if (type == TLM_REPLY || type == TLM_TRACE) {
+		serial_begin_message(SERIAL_PRIORITY_HIGH);
+	} else {
+		serial_begin_message(SERIAL_PRIORITY_LOW);
+	}
+	serial_write_raw(frame, out);
+	serial_end_message();
+}
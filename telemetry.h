@@ -0,0 +1,71 @@
+/*
+ * telemetry.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Compact binary alternative to the ANSI terminal output. When binary
+ * mode is enabled, status changes are sent as small records instead of
+ * text. Each record is
+ *     <type> <sequence number> <payload...> <CRC-8>
+ * where the CRC-8 (polynomial 0x07, initial value 0) covers the type,
+ * sequence number and payload. The record is COBS encoded (so it
+ * contains no zero bytes) and followed by a single 0x00 delimiter.
+ * tools/telemetry_decode.py decodes the stream on the host.
+ *
+ * Record payloads (all values unsigned, multi-byte values little endian):
+ *     TLM_POSITION   row (0-12), floor (0-3)
+ *     TLM_DIRECTION  direction (TLM_DIRECTION_xxx)
+ *     TLM_QUEUE      count, then one byte per traveller:
+ *                    (origin floor << 4) | destination floor
+ *     TLM_DOOR       1 when the doors start opening, 0 when closed
+ *     TLM_METRICS    floors with traveller, floors without traveller,
+ *                    input overruns (16 bits)
+ *     TLM_REPLY      command id, 1 if ok / 0 if error
+ *     TLM_LOG        message id, 16 bit arguments (see binlog.h)
+ *     TLM_TRACE      index of the first record, then up to 5 trace
+ *                    records (delta (16 bits), type, arg - see trace.h)
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+// Largest payload that can be sent in one record
+#define TELEMETRY_MAX_PAYLOAD 24
+
+typedef enum {
+	TLM_POSITION = 1,
+	TLM_DIRECTION = 2,
+	TLM_QUEUE = 3,
+	TLM_DOOR = 4,
+	TLM_METRICS = 5,
+	TLM_REPLY = 6,
+	TLM_LOG = 7,
+	TLM_TRACE = 8
+} TelemetryRecord;
+
+#define TLM_DIRECTION_STATIONARY 0
+#define TLM_DIRECTION_UP 1
+#define TLM_DIRECTION_DOWN 2
+
+/* Select text (0) or binary (non-zero) output. Text is the default. */
+void telemetry_set_binary(uint8_t binary);
+
+// Set by telemetry_set_binary()
+extern uint8_t telemetry_binary_mode;
+
+/* Return non-zero if binary telemetry is enabled. This is inline so that
+ * the check is a single load and test.
+ */
+static inline uint8_t telemetry_binary(void) {
+	return telemetry_binary_mode;
+}
+
+/* Send a record with the given type and payload (of up to
+ * TELEMETRY_MAX_PAYLOAD bytes). Nothing is sent unless binary
+ * mode is enabled.
+ */
+void telemetry_send(TelemetryRecord type, const uint8_t* payload, uint8_t length);
+
+#endif /* TELEMETRY_H_ */
@@ -10,53 +10,86 @@
 #include <avr/pgmspace.h>
 
 #include "terminalio.h"
+#include "serialio.h"
+
+/* Escape sequences are built in a small buffer and sent with a single
+ * serial_write() (or serial_write_P() for fixed sequences) rather than
+ * going through printf.
+ */
+
+// Send ESC [ a ; b <final> (or ESC [ a <final> if b is negative)
+static void send_csi(int a, int b, char final) {
+	char sequence[14];
+	uint8_t length = 2;
+	sequence[0] = '\x1b';
+	sequence[1] = '[';
+	length += serial_format_uint(sequence + length, a);
+	if (b >= 0) {
+		sequence[length++] = ';';
+		length += serial_format_uint(sequence + length, b);
+	}
+	sequence[length++] = final;
+	serial_write(sequence, length);
+}
 
 void move_terminal_cursor(int x, int y) {
-    printf_P(PSTR("\x1b[%d;%dH"), y, x);
+	send_csi(y, x, 'H');
+}
+
+void move_terminal_cursor_right(int n) {
+	send_csi(n, -1, 'C');
 }
 
 void normal_display_mode(void) {
-	printf_P(PSTR("\x1b[0m"));
+	serial_write_P(PSTR("\x1b[0m"));
 }
 
 void reverse_video(void) {
-	printf_P(PSTR("\x1b[7m"));
+	serial_write_P(PSTR("\x1b[7m"));
 }
 
 void clear_terminal(void) {
-	printf_P(PSTR("\x1b[2J"));
+	serial_write_P(PSTR("\x1b[2J"));
 }
 
 void clear_to_end_of_line(void) {
-	printf_P(PSTR("\x1b[K"));
+	serial_write_P(PSTR("\x1b[K"));
 }
 
 void set_display_attribute(DisplayParameter parameter) {
-	printf_P(PSTR("\x1b[%dm"), parameter);
+	send_csi(parameter, -1, 'm');
 }
 
 void hide_cursor() {
-	printf_P(PSTR("\x1b[?25l"));
+	serial_write_P(PSTR("\x1b[?25l"));
 }
 
 void show_cursor() {
-	printf_P(PSTR("\x1b[?25h"));
+	serial_write_P(PSTR("\x1b[?25h"));
+}
+
+void save_cursor(void) {
+	serial_write_P(PSTR("\x1b" "7"));	// ESC-7
+}
+
+void restore_cursor(void) {
+	serial_write_P(PSTR("\x1b" "8"));	// ESC-8
 }
 
 void enable_scrolling_for_whole_display(void) {
-	printf_P(PSTR("\x1b[r"));
+	serial_write_P(PSTR("\x1b[r"));
 }
 
 void set_scroll_region(int8_t y1, int8_t y2) {
-	printf_P(PSTR("\x1b[%d;%dr"), y1, y2);
+	send_csi(y1, y2, 'r');
 }
 
 void scroll_down(void) {
-	printf_P(PSTR("\x1bM"));	// ESC-M
+	serial_write_P(PSTR("\x1bM"));	// ESC-M
 }
 
 void scroll_up(void) {
-	printf_P(PSTR("\x1b\x44"));	// ESC-D
+	serial_write_P(PSTR("\x1b\x44"));	// ESC-D
 }
 
 void draw_horizontal_line(int8_t y, int8_t start_x, int8_t end_x) {
@@ -55,6 +55,8 @@ typedef enum {
 } DisplayParameter;
 
 void move_terminal_cursor(int x, int y);
+// Move the cursor n columns to the right (n must be at least 1)
+void move_terminal_cursor_right(int n);
 void normal_display_mode(void);
 void reverse_video(void);
 void clear_terminal(void);
@@ -63,6 +65,10 @@ void set_display_attribute(DisplayParameter parameter);
 void hide_cursor(void);
 void show_cursor(void);
 
+// Save the cursor position (and display attributes) and go back to it
+void save_cursor(void);
+void restore_cursor(void);
+
 // Enable scrolling for either the full screen or a particular region (rows)
 // For set_scroll_region y1 < y2 and the region includes rows y1 and y2.
 void enable_scrolling_for_whole_display(void);
@@ -0,0 +1,162 @@
+/*
+ * termscreen.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See termscreen.h. The shadow holds what the terminal should show once
+ * the next refresh has been sent, and one bit per cell records whether
+ * the terminal is known to show it already.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "termscreen.h"
+#include "terminalio.h"
+#include "serialio.h"
+#include "timer0.h"
+
+#define DIRTY_BYTES ((TERMSCREEN_COLUMNS + 7) / 8)
+
+static char cells[TERMSCREEN_ROWS][TERMSCREEN_COLUMNS];
+static uint8_t dirty[TERMSCREEN_ROWS][DIRTY_BYTES];
+static uint8_t any_dirty;
+
+static uint16_t refresh_period = TERMSCREEN_REFRESH_PERIOD;
+static uint32_t last_refresh;
+
+// Set cell (x, y) (counted from 0) to c, marking it if it has changed
+static void set_cell(uint8_t x, uint8_t y, char c) {
+	if (cells[y][x] != c) {
+		cells[y][x] = c;
+		dirty[y][x >> 3] |= 1 << (x & 7);
+		any_dirty = 1;
+	}
+}
+
+static uint8_t is_dirty(uint8_t x, uint8_t y) {
+	return dirty[y][x >> 3] & (1 << (x & 7));
+}
+
+// Number of characters needed to send value in decimal
+static uint8_t decimal_length(uint8_t value) {
+	return value >= 100 ? 3 : (value >= 10 ? 2 : 1);
+}
+
+void termscreen_clear(void) {
+	memset(cells, ' ', sizeof(cells));
+	memset(dirty, 0, sizeof(dirty));
+	any_dirty = 0;
+}
+
+void termscreen_invalidate(void) {
+	for (uint8_t y = 0; y < TERMSCREEN_ROWS; y++) {
+		for (uint8_t x = 0; x < TERMSCREEN_COLUMNS; x++) {
+			if (cells[y][x] != ' ') {
+				dirty[y][x >> 3] |= 1 << (x & 7);
+				any_dirty = 1;
+			}
+		}
+	}
+}
+
+uint8_t termscreen_write(uint8_t x, uint8_t y, const char* text, uint8_t length) {
+	if (y < 1 || y > TERMSCREEN_ROWS) {
+		return x;
+	}
+	while (length-- > 0 && x >= 1 && x <= TERMSCREEN_COLUMNS) {
+		set_cell(x - 1, y - 1, *text++);
+		x++;
+	}
+	return x;
+}
+
+uint8_t termscreen_write_P(uint8_t x, uint8_t y, const char* text) {
+	char c;
+	if (y < 1 || y > TERMSCREEN_ROWS) {
+		return x;
+	}
+	while ((c = pgm_read_byte(text++)) != '\0' && x >= 1 && x <= TERMSCREEN_COLUMNS) {
+		set_cell(x - 1, y - 1, c);
+		x++;
+	}
+	return x;
+}
+
+uint8_t termscreen_write_uint(uint8_t x, uint8_t y, uint16_t value) {
+	char digits[5];
+	return termscreen_write(x, y, digits, serial_format_uint(digits, value));
+}
+
+void termscreen_clear_to_end(uint8_t x, uint8_t y) {
+	if (y < 1 || y > TERMSCREEN_ROWS) {
+		return;
+	}
+	for (; x >= 1 && x <= TERMSCREEN_COLUMNS; x++) {
+		set_cell(x - 1, y - 1, ' ');
+	}
+}
+
+void termscreen_set_refresh_period(uint16_t period) {
+	refresh_period = period;
+}
+
+uint16_t termscreen_get_refresh_period(void) {
+	return refresh_period;
+}
+
+int8_t termscreen_refresh(void) {
+	uint32_t now = get_current_time();
+	if (!any_dirty || now - last_refresh < refresh_period) {
+		return 0;
+	}
+
+	if (serial_begin_message(SERIAL_PRIORITY_LOW)) {
+		// Other output may have moved the cursor since the last refresh,
+		// so the first move has to be absolute. cursor_x and cursor_y
+		// count from 0 like the cells.
+		uint8_t cursor_x = 0;
+		uint8_t cursor_y = 0xFF;
+
+		for (uint8_t y = 0; y < TERMSCREEN_ROWS; y++) {
+			uint8_t x = 0;
+			while (x < TERMSCREEN_COLUMNS) {
+				if (!is_dirty(x, y)) {
+					x++;
+					continue;
+				}
+
+				// Get the cursor to x using the fewest characters
+				uint8_t gap = x - cursor_x;
+				if (cursor_y == y && cursor_x <= x
+						&& gap <= 3 + decimal_length(gap)) {
+					// Re-sending the characters in between is no longer than
+					// ESC [ n C. (The terminal already shows them.)
+					serial_write(&cells[y][cursor_x], gap);
+				} else if (cursor_y == y && cursor_x <= x) {
+					move_terminal_cursor_right(gap);
+				} else {
+					move_terminal_cursor(x + 1, y + 1);
+				}
+
+				// Send the run of changed cells
+				uint8_t start = x;
+				while (x < TERMSCREEN_COLUMNS && is_dirty(x, y)) {
+					x++;
+				}
+				serial_write(&cells[y][start], x - start);
+				cursor_x = x;
+				cursor_y = y;
+			}
+		}
+	}
+	// If anything was discarded the marks are kept and we try again next
+	// time (after another refresh period, to let the output drain)
+	if (serial_end_message()) {
+		memset(dirty, 0, sizeof(dirty));
+		any_dirty = 0;
+	}
+	last_refresh = now;
+	return !any_dirty;
+}
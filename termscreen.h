@@ -0,0 +1,77 @@
+/*
+ * termscreen.h
+ *
+ * Author: Yiyang Yu
+ *
+ * Shadow copy of the status region at the top of the terminal. Callers
+ * write text into the cells of the shadow (which costs no serial output)
+ * and termscreen_refresh() then sends only the cells that have changed
+ * since they were last sent, moving the cursor between them with
+ * whichever is shortest of an absolute move, a relative move or simply
+ * re-sending the unchanged characters in between.
+ *
+ * Refreshes happen at most once every refresh period, so however often
+ * the status changes the serial bandwidth it uses is bounded. Changes
+ * that happen between refreshes are merged, and a cell that changes and
+ * then changes back costs nothing.
+ *
+ * Cells are addressed with x (column) and y (row) starting from 1, the
+ * same as move_terminal_cursor(). Text that would go past the last
+ * column is cut off.
+ */
+
+#ifndef TERMSCREEN_H_
+#define TERMSCREEN_H_
+
+#include <stdint.h>
+
+// Size of the shadow region (which starts at the top left of the terminal)
+#ifndef TERMSCREEN_ROWS
+#define TERMSCREEN_ROWS 5
+#endif
+#ifndef TERMSCREEN_COLUMNS
+#define TERMSCREEN_COLUMNS 32
+#endif
+
+// Default minimum time between refreshes (ms)
+#ifndef TERMSCREEN_REFRESH_PERIOD
+#define TERMSCREEN_REFRESH_PERIOD 50
+#endif
+
+/* Fill the shadow with spaces. This should be called just after the
+ * terminal has been cleared - nothing is marked as needing to be sent.
+ */
+void termscreen_clear(void);
+
+/* Mark every non-blank cell as needing to be sent, e.g. after the
+ * terminal has been cleared by something else.
+ */
+void termscreen_invalidate(void);
+
+/* Write text into the shadow starting at column x of row y.
+ * termscreen_write_P() takes a string in program memory.
+ * termscreen_write_uint() writes a number in decimal.
+ * termscreen_clear_to_end() fills the rest of row y from column x with
+ * spaces.
+ * Each returns the column after the last one written so calls can be
+ * chained along a row.
+ */
+uint8_t termscreen_write(uint8_t x, uint8_t y, const char* text, uint8_t length);
+uint8_t termscreen_write_P(uint8_t x, uint8_t y, const char* text);
+uint8_t termscreen_write_uint(uint8_t x, uint8_t y, uint16_t value);
+void termscreen_clear_to_end(uint8_t x, uint8_t y);
+
+/* Set the minimum time (ms) between refreshes. 0 refreshes every time
+ * termscreen_refresh() is called.
+ */
+void termscreen_set_refresh_period(uint16_t period);
+uint16_t termscreen_get_refresh_period(void);
+
+/* Send the changed cells to the terminal if the refresh period has passed
+ * since the last refresh. The output is a low priority serial message -
+ * if it is discarded the cells stay marked and are sent next time.
+ * Returns non-zero if anything was sent.
+ */
+int8_t termscreen_refresh(void);
+
+#endif /* TERMSCREEN_H_ */
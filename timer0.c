@@ -12,6 +12,10 @@
 #include <avr/interrupt.h>
 
 #include "timer0.h"
+#include "animation.h"
+#include "inputs.h"
+#include "profile.h"
+#include "ssd.h"
 
 /* Our internal clock tick count - incremented every 
  * millisecond. Will overflow every ~49 days. */
@@ -73,7 +77,38 @@ uint32_t get_current_time(void) {
 	return returnValue;
 }
 
+uint32_t get_current_time_us(void) {
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	uint32_t ticks = clockTicks;
+	uint8_t count = TCNT0;
+	/* If the counter has just wrapped but the interrupt hasn't
+	 * run yet, the tick count is one behind.
+	 */
+	if((TIFR0 & (1<<OCF0A)) && count < OCR0A) {
+		ticks++;
+	}
+	if(interruptsOn) {
+		sei();
+	}
+	/* Each count is 64 clock cycles, i.e. 8us at 8MHz */
+	return ticks * 1000 + count * 8;
+}
+
+uint16_t get_clock_ticks_low(void) {
+	return (uint16_t)clockTicks;
+}
+
 ISR(TIMER0_COMPA_vect) {
+	PROFILE_TICK_LATENCY();
+	PROFILE_ENTER();
 	/* Increment our clock tick count */
 	clockTicks++;
+	/* Blank the seven segment display and select the next digit (lit
+	 * later in the tick by ssd.c), then step the LED animations */
+	ssd_tick();
+	animation_tick();
+	/* Sample the push buttons and switches */
+	inputs_tick(clockTicks);
+	PROFILE_EXIT(PROFILE_TIMER0);
 }
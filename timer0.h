@@ -30,4 +30,16 @@ void init_timer0(void);
  */
 uint32_t get_current_time(void);
 
+/* Return the time since the timer was initialised in microseconds (to
+ * the nearest 8us). Wraps after about 71 minutes, so it is only useful
+ * for timing short things.
+ */
+uint32_t get_current_time_us(void);
+
+/* Return the low 16 bits of the clock tick value. This must only be
+ * called with interrupts disabled (e.g. from an interrupt handler) - it
+ * doesn't protect the read itself so that it can be as cheap as possible.
+ */
+uint16_t get_clock_ticks_low(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+"""
+gen_assets.py
+
+Turns LED matrix image sequences (see tools/splash.txt for the format)
+into C source holding, in program memory, the exact LED matrix commands
+to draw each step. The first image is drawn in full. After that each step
+only redraws what changed since the previous image, using whichever of
+column, row or pixel commands (or a full update) sends the fewest bytes.
+The player (see display.c) just streams each step's bytes to the matrix.
+
+For a sequence named "splash" this writes splash_assets.h and
+splash_assets.c containing
+    SPLASH_NUM_STEPS, SPLASH_LOOP_STEP
+    splash_payload[]      the commands for all of the steps
+    splash_steps[][3]     offset and length in splash_payload, then the
+                          time (ms) to show the step for
+
+Usage:
+    gen_assets.py tools/splash.txt              (writes to the current directory)
+    gen_assets.py tools/splash.txt --out path/to/source
+"""
+
+import argparse
+import os
+import sys
+
+WIDTH = 16
+HEIGHT = 8
+
+# As pixel_colour.h
+PALETTE = {
+    ".": 0x00,
+    "R": 0x0F,
+    "G": 0xF0,
+    "Y": 0xDF,
+    "O": 0x3C,
+}
+
+# LED matrix commands (see ledmatrix.c)
+CMD_UPDATE_ALL = 0x00
+CMD_UPDATE_PIXEL = 0x01
+CMD_UPDATE_ROW = 0x02
+CMD_UPDATE_COL = 0x03
+CMD_CLEAR_SCREEN = 0x0F
+
+
+class AssetError(Exception):
+    pass
+
+
+def parse(path):
+    """Return (images, sequences). An image is image[x][y] with y = 0 at the
+    bottom. A sequence is (list of (image name, ms), loop index or None)."""
+    images = {}
+    sequences = {}
+    current_image = None
+    current_sequence = None
+    with open(path) as source:
+        for number, line in enumerate(source, 1):
+            line = line.rstrip("\n")
+            where = "%s:%d" % (path, number)
+            if not line.strip() or line.startswith("#"):
+                continue
+            words = line.split()
+            if words[0] == "image" and len(words) == 2:
+                current_image = []
+                current_sequence = None
+                images[words[1]] = current_image
+            elif words[0] == "sequence" and len(words) == 2:
+                current_image = None
+                current_sequence = {"shows": [], "loop": None}
+                sequences[words[1]] = current_sequence
+            elif words[0] == "show" and len(words) == 3 and current_sequence is not None:
+                current_sequence["shows"].append((words[1], int(words[2])))
+            elif words[0] == "loop" and len(words) == 2 and current_sequence is not None:
+                current_sequence["loop"] = int(words[1])
+            elif current_image is not None and len(current_image) < HEIGHT:
+                if len(line) != WIDTH or any(c not in PALETTE for c in line):
+                    raise AssetError("%s: expected %d of %s" % (where, WIDTH, "".join(PALETTE)))
+                current_image.append([PALETTE[c] for c in line])
+            else:
+                raise AssetError("%s: can't understand %r" % (where, line))
+
+    result = {}
+    for name, rows in images.items():
+        if len(rows) != HEIGHT:
+            raise AssetError("image %s has %d rows, not %d" % (name, len(rows), HEIGHT))
+        # Rows are listed top first
+        result[name] = [[rows[HEIGHT - 1 - y][x] for y in range(HEIGHT)] for x in range(WIDTH)]
+    sequences = {name: (sequence["shows"], sequence["loop"])
+                 for name, sequence in sequences.items()}
+    for name, (shows, loop) in sequences.items():
+        for image, _ in shows:
+            if image not in result:
+                raise AssetError("sequence %s shows unknown image %s" % (name, image))
+        if loop is not None and not 0 <= loop < len(shows):
+            raise AssetError("sequence %s loops to a step it doesn't have" % name)
+    return result, sequences
+
+
+def full_draw(image):
+    """Commands to draw an image from scratch (the cheapest of a full
+    update or clearing and drawing the columns that aren't blank)."""
+    update_all = [CMD_UPDATE_ALL] + [image[x][y] for y in range(HEIGHT) for x in range(WIDTH)]
+    blank = [[0] * HEIGHT for _ in range(WIDTH)]
+    cleared = [CMD_CLEAR_SCREEN] + delta(blank, image)
+    return min(update_all, cleared, key=len)
+
+
+def delta(old, new):
+    """Commands to change old into new - by column or by row, whichever is
+    smaller, sending single pixels where that is cheaper than a whole line."""
+    by_column = []
+    for x in range(WIDTH):
+        changed = [y for y in range(HEIGHT) if old[x][y] != new[x][y]]
+        pixels = []
+        for y in changed:
+            pixels += [CMD_UPDATE_PIXEL, (y << 4) | x, new[x][y]]
+        line = [CMD_UPDATE_COL, x] + new[x]
+        if changed:
+            by_column += min(pixels, line, key=len)
+    by_row = []
+    for y in range(HEIGHT):
+        changed = [x for x in range(WIDTH) if old[x][y] != new[x][y]]
+        pixels = []
+        for x in changed:
+            pixels += [CMD_UPDATE_PIXEL, (y << 4) | x, new[x][y]]
+        line = [CMD_UPDATE_ROW, y] + [new[x][y] for x in range(WIDTH)]
+        if changed:
+            by_row += min(pixels, line, key=len)
+    return min(by_column, by_row, key=len)
+
+
+def build(images, shows, loop):
+    """Return (steps, loop step) where each step is (commands, ms)."""
+    frames = [(images[name], ms) for name, ms in shows]
+    steps = [(full_draw(frames[0][0]), frames[0][1])]
+    for i in range(1, len(frames)):
+        steps.append((delta(frames[i - 1][0], frames[i][0]), frames[i][1]))
+    if loop is None:
+        return steps, None
+    # Going back round needs its own step, from the last image to the
+    # loop image, after which play carries on from the step after it
+    steps.append((delta(frames[-1][0], frames[loop][0]), frames[loop][1]))
+    return steps, loop + 1
+
+
+def c_bytes(data, indent="\t"):
+    lines = []
+    for i in range(0, len(data), 12):
+        lines.append(indent + ", ".join("0x%02X" % b for b in data[i:i + 12]) + ",")
+    return "\n".join(lines)
+
+
+def write_sequence(name, steps, loop_step, source, out_dir):
+    upper = name.upper()
+    header = "%s_assets.h" % name
+    guard = "%s_ASSETS_H_" % upper
+    note = ("Generated by tools/gen_assets.py from %s - do not edit.\n"
+            " * Run the generator again after changing the images." % source)
+
+    payload = []
+    table = []
+    for commands, ms in steps:
+        table.append((len(payload), len(commands), ms))
+        payload += commands
+
+    with open(os.path.join(out_dir, header), "w") as h:
+        h.write("/*\n * %s\n *\n * %s\n */\n\n" % (header, note))
+        h.write("#ifndef %s\n#define %s\n\n" % (guard, guard))
+        h.write("#include <stdint.h>\n#include <avr/pgmspace.h>\n\n")
+        h.write("#define %s_NUM_STEPS %d\n" % (upper, len(steps)))
+        h.write("// Step to carry on from after the last (%s_NUM_STEPS to stop)\n" % upper)
+        h.write("#define %s_LOOP_STEP %d\n\n" % (upper, len(steps) if loop_step is None else loop_step))
+        h.write("// LED matrix commands for all of the steps\n")
+        h.write("extern const uint8_t %s_payload[%d] PROGMEM;\n" % (name, len(payload)))
+        h.write("// For each step: offset and length in %s_payload, ms to show it for\n" % name)
+        h.write("extern const uint16_t %s_steps[%s_NUM_STEPS][3] PROGMEM;\n\n" % (name, upper))
+        h.write("#endif /* %s */\n" % guard)
+
+    with open(os.path.join(out_dir, "%s_assets.c" % name), "w") as c:
+        c.write("/*\n * %s_assets.c\n *\n * %s\n */\n\n" % (name, note))
+        c.write('#include "%s"\n\n' % header)
+        c.write("const uint8_t %s_payload[%d] PROGMEM = {\n" % (name, len(payload)))
+        for i, (commands, ms) in enumerate(steps):
+            c.write("\t// Step %d (%d bytes)\n" % (i, len(commands)))
+            c.write(c_bytes(commands) + "\n")
+        c.write("};\n\n")
+        c.write("const uint16_t %s_steps[%s_NUM_STEPS][3] PROGMEM = {\n" % (name, upper))
+        c.write(",\n".join("\t{%d, %d, %d}" % row for row in table) + "\n};\n")
+    return len(payload)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="image definitions")
+    parser.add_argument("--out", default=".", help="directory to write the C files to")
+    args = parser.parse_args()
+
+    try:
+        images, sequences = parse(args.source)
+    except (AssetError, ValueError) as error:
+        sys.exit("gen_assets: %s" % error)
+    source = os.path.relpath(args.source, args.out).replace(os.sep, "/")
+    for name, (shows, loop) in sequences.items():
+        steps, loop_step = build(images, shows, loop)
+        size = write_sequence(name, steps, loop_step, source, args.out)
+        print("%s: %d steps, %d bytes (%s)" % (name, len(steps), size,
+                                             ", ".join(str(len(s[0])) for s in steps)))
+
+
+if __name__ == "__main__":
+    main()
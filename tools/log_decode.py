@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""
+log_decode.py
+
+Turns the binary log records (TLM_LOG telemetry records, see binlog.h)
+sent by the elevator controller back into readable text, using the
+format strings in log_messages.h. Other telemetry records are shown as
+decoded by telemetry_decode.py.
+
+Usage:
+    log_decode.py capture.bin
+    log_decode.py --port /dev/ttyUSB0      (needs pyserial)
+    log_decode.py --messages path/to/log_messages.h ...
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import telemetry_decode  # noqa: E402
+
+TLM_LOG = 7
+
+MESSAGE_PATTERN = re.compile(r'^\s*LOG_MESSAGE\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)',
+                             re.MULTILINE)
+SPEC_PATTERN = re.compile(r"%([-+ 0#]*\d*)([udxXc%])")
+
+
+def load_messages(path):
+    """Return a list of (name, format) in message id order."""
+    with open(path) as header:
+        text = header.read()
+    return [(name, fmt.encode().decode("unicode_escape"))
+            for name, fmt in MESSAGE_PATTERN.findall(text)]
+
+
+def format_message(fmt, payload):
+    """Apply the 16 bit little endian arguments in payload to fmt."""
+    count = len(payload) // 2
+    args = list(struct.unpack("<%dH" % count, payload[:count * 2]))
+    values = []
+
+    def convert(match):
+        flags, conversion = match.groups()
+        if conversion == "%":
+            return "%%"
+        if not args:
+            return "<missing>"
+        value = args.pop(0)
+        if conversion == "d" and value >= 0x8000:
+            value -= 0x10000
+        values.append(value)
+        return "%" + flags + conversion
+
+    python_fmt = SPEC_PATTERN.sub(convert, fmt)
+    return python_fmt % tuple(values)
+
+
+def main():
+    default_messages = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                    os.pardir, "log_messages.h")
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="captured stream (default stdin)")
+    parser.add_argument("--port", help="serial port to read live")
+    parser.add_argument("--baud", type=int, default=19200)
+    parser.add_argument("--messages", default=default_messages,
+                        help="log_messages.h to take the formats from")
+    args = parser.parse_args()
+
+    messages = load_messages(args.messages)
+    decoder = telemetry_decode.Decoder()
+    try:
+        for chunk in telemetry_decode.read_chunks(args):
+            for record_type, sequence, payload in decoder.feed(chunk):
+                if record_type == TLM_LOG and payload:
+                    if payload[0] < len(messages):
+                        name, fmt = messages[payload[0]]
+                        text = format_message(fmt, payload[1:])
+                    else:
+                        text = "unknown message %d %s" % (payload[0], payload[1:].hex())
+                    print("%3d %s" % (sequence, text))
+                else:
+                    print("%3d %s" % (sequence, telemetry_decode.describe(record_type, payload)))
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    print("bad frames: %d, lost records: %d" % (decoder.bad_frames, decoder.lost_records),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+ram_report.py
+
+Shows how the ATmega324A's 2KB of RAM is split between the modules, from
+the linker map file (link with -Wl,-Map=Elevator-Emulator.map). Each
+object file's .data, .bss and .noinit contributions are totalled, with
+library objects grouped under their library.
+
+Given a serial port it also asks the running controller ("ram" command)
+for its stack high water mark and the least free RAM there has been, so
+the headroom left for bigger buffers or queues can be seen. The
+controller must be in text mode (not "telemetry 1").
+
+Usage:
+    ram_report.py Elevator-Emulator.map
+    ram_report.py Elevator-Emulator.map --port /dev/ttyUSB0    (needs pyserial)
+"""
+
+import argparse
+import os
+import re
+import sys
+import time
+
+RAM_SIZE = 2048
+
+# An input section in the memory map, e.g.
+#  .bss           0x00800212       0x10 serialio.o
+#  COMMON         0x00800400        0x2 Elevator-Emulator.o
+# A long section name is put on a line of its own, with the rest on the
+# next line.
+SECTION = re.compile(r"^ (\.data|\.bss|\.noinit|COMMON)(\S*)$")
+SECTION_LINE = re.compile(r"^ (\.data|\.bss|\.noinit|COMMON)(\S*)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+CONTINUATION = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+RAM_REPLY = re.compile(rb"data:(\d+) bss:(\d+) heap:(\d+) stack:(\d+) maxstack:(\d+) minfree:(\d+)")
+
+
+def module_name(source):
+    """libc.a(vfprintf_std.o) -> libc.a, path/serialio.o -> serialio"""
+    source = source.strip()
+    library = re.match(r"(.*\.a)\(", source)
+    if library:
+        return os.path.basename(library.group(1))
+    return os.path.splitext(os.path.basename(source))[0]
+
+
+def parse_map(path):
+    """Return {module: {"data": bytes, "bss": bytes}}."""
+    modules = {}
+    in_map = False
+    pending = None
+    with open(path) as map_file:
+        for line in map_file:
+            line = line.rstrip("\n")
+            if line.startswith("Linker script and memory map"):
+                in_map = True
+                continue
+            if not in_map:
+                continue
+            kind = size = source = None
+            match = SECTION_LINE.match(line)
+            if match:
+                kind, size, source = match.group(1), int(match.group(4), 16), match.group(5)
+            elif pending and CONTINUATION.match(line):
+                match = CONTINUATION.match(line)
+                kind, size, source = pending, int(match.group(2), 16), match.group(3)
+            pending = None
+            if kind is None:
+                match = SECTION.match(line)
+                if match:
+                    pending = match.group(1)
+                continue
+            if size == 0:
+                continue
+            column = "data" if kind == ".data" else "bss"
+            sizes = modules.setdefault(module_name(source), {"data": 0, "bss": 0})
+            sizes[column] += size
+    return modules
+
+
+def ask_controller(port_name, baud):
+    import serial
+    with serial.Serial(port_name, baud, timeout=1) as port:
+        port.reset_input_buffer()
+        port.write(b"\nram\n")
+        time.sleep(0.3)
+        match = RAM_REPLY.search(port.read_until(b"OK"))
+    if not match:
+        sys.exit("ram_report: no reply to the ram command")
+    return [int(value) for value in match.groups()]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="linker map file")
+    parser.add_argument("--port", help="serial port of the running controller")
+    parser.add_argument("--baud", type=int, default=19200)
+    args = parser.parse_args()
+
+    modules = parse_map(args.map)
+    if not modules:
+        sys.exit("ram_report: no .data or .bss sections found in %s" % args.map)
+
+    print("%-24s %6s %6s %6s %6s" % ("module", "data", "bss", "total", "%RAM"))
+    total_data = total_bss = 0
+    for name, sizes in sorted(modules.items(), key=lambda item: -(item[1]["data"] + item[1]["bss"])):
+        total = sizes["data"] + sizes["bss"]
+        total_data += sizes["data"]
+        total_bss += sizes["bss"]
+        print("%-24s %6d %6d %6d %5.1f%%" % (name, sizes["data"], sizes["bss"], total,
+                                             100.0 * total / RAM_SIZE))
+    static = total_data + total_bss
+    print("%-24s %6d %6d %6d %5.1f%%" % ("total", total_data, total_bss, static,
+                                         100.0 * static / RAM_SIZE))
+    print("left for the heap and stack: %d bytes" % (RAM_SIZE - static))
+
+    if args.port:
+        data, bss, heap, stack, max_stack, min_free = ask_controller(args.port, args.baud)
+        if data + bss != static:
+            print("warning: the controller reports %d bytes of static RAM - "
+                  "is the map file from the build it is running?" % (data + bss))
+        print("stack now %d, high water mark %d bytes, heap %d bytes" % (stack, max_stack, heap))
+        print("headroom (least free RAM so far): %d bytes" % min_free)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""
+send_commands.py
+
+Streams serial commands (one per line, e.g. "enq 0 3" or "batch 0 3 1 2")
+to the elevator controller as fast as the link allows. XON/XOFF flow
+control is turned on at both ends first ("flow 1"), so the controller
+can hold the stream back whenever its input buffer fills and nothing is
+lost. Afterwards the controller's "stats" reply is printed, which
+includes its receive overrun, framing error and XOFF counts.
+
+Usage:
+    send_commands.py --port /dev/ttyUSB0 commands.txt     (needs pyserial)
+    generate_load | send_commands.py --port /dev/ttyUSB0
+"""
+
+import argparse
+import re
+import sys
+import time
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="commands to send (default stdin)")
+    parser.add_argument("--port", required=True, help="serial port")
+    parser.add_argument("--baud", type=int, default=19200)
+    args = parser.parse_args()
+
+    import serial
+    source = open(args.file) if args.file else sys.stdin
+    with serial.Serial(args.port, args.baud, timeout=0.5) as port:
+        # Turn flow control on at the controller before the host starts
+        # honouring XOFF, then send everything
+        port.write(b"\nflow 1\n")
+        port.flush()
+        time.sleep(0.2)
+        port.xonxoff = True
+        port.reset_input_buffer()
+
+        count = 0
+        start = time.time()
+        for line in source:
+            line = line.strip()
+            if line:
+                port.write(line.encode() + b"\n")
+                count += 1
+        port.flush()
+        elapsed = time.time() - start
+        print("sent %d commands in %.2f s" % (count, elapsed), file=sys.stderr)
+
+        time.sleep(0.5)
+        port.reset_input_buffer()
+        port.write(b"stats\n")
+        reply = port.read_until(b"OK").decode(errors="replace")
+        # The counters come a group per terminal row - drop the cursor
+        # movement between them (and any other screen updates)
+        for text in re.split(r"\x1b\[[0-9;]*[A-Za-z]", reply):
+            if ":" in text:
+                print(text.strip())
+
+
+if __name__ == "__main__":
+    main()
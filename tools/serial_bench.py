@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+serial_bench.py
+
+Measures serial throughput at each baud rate the elevator controller
+supports. For each rate the controller is switched over with the "baud"
+command, then asked to send a test pattern with the "bench" command. The
+table shows the rate the controller measured (time to empty its output
+buffer), the rate seen by the host and how close that is to the line
+rate (10 bits per byte), along with any pattern bytes that arrived
+corrupted. The controller is put back to the starting rate at the end.
+
+The controller must be in text mode (not "telemetry 1").
+
+Usage:
+    serial_bench.py --port /dev/ttyUSB0              (needs pyserial)
+    serial_bench.py --port /dev/ttyUSB0 --bytes 50000 --rates 19200 76800
+"""
+
+import argparse
+import re
+import sys
+import time
+
+# The rates that can be generated to within 2% from an 8MHz clock
+# (see serialio.h)
+DEFAULT_RATES = [9600, 19200, 38400, 76800, 250000, 500000, 1000000]
+PATTERN = b"0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ\n"
+RESULT = re.compile(rb"bench:(\d+) baud:(\d+) ms:(\d+) bytes/s:(\d+) (OK|ERR)")
+
+
+def read_until(port, pattern, timeout):
+    """Read until pattern (a compiled regex) matches, return (match, data)."""
+    data = b""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        data += port.read(256)
+        match = pattern.search(data)
+        if match:
+            return match, data
+    return None, data
+
+
+def command(port, text, timeout=2.0):
+    """Send a command line, return True if the controller replied OK."""
+    port.reset_input_buffer()
+    port.write(text.encode() + b"\n")
+    match, _ = read_until(port, re.compile(rb"(OK|ERR)"), timeout)
+    return match is not None and match.group(1) == b"OK"
+
+
+def count_errors(data, length):
+    """Count bytes of the received pattern that don't match what was sent."""
+    expected = (PATTERN * (length // len(PATTERN) + 1))[:length]
+    start = data.find(PATTERN[:16])
+    received = data[start:start + length] if start >= 0 else b""
+    errors = sum(1 for a, b in zip(received, expected) if a != b)
+    return errors + length - len(received)
+
+
+def bench(port, rate, length):
+    """Switch to rate and run the benchmark. Returns a result row or None."""
+    if not command(port, "baud %d" % rate):
+        return None
+    port.baudrate = rate
+    time.sleep(0.05)
+    port.reset_input_buffer()
+    start = time.time()
+    port.write(b"bench %d\n" % length)
+    # Allow twice the time the pattern should take at the line rate
+    match, data = read_until(port, RESULT, 2.0 + 20.0 * length / rate)
+    elapsed = time.time() - start
+    if match is None:
+        return (rate, None, None, None, count_errors(data, length))
+    device_rate = int(match.group(4))
+    host_rate = length / elapsed
+    return (rate, device_rate, host_rate, 100.0 * host_rate / (rate / 10.0),
+            count_errors(data, length))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", required=True, help="serial port")
+    parser.add_argument("--baud", type=int, default=19200,
+                        help="rate the controller is using now")
+    parser.add_argument("--bytes", type=int, default=20000,
+                        help="size of the test pattern")
+    parser.add_argument("--rates", type=int, nargs="+", default=DEFAULT_RATES)
+    args = parser.parse_args()
+
+    import serial
+    with serial.Serial(args.port, args.baud, timeout=0.05) as port:
+        print("%8s %12s %12s %9s %7s" % ("baud", "device B/s", "host B/s", "of line", "errors"))
+        for rate in args.rates:
+            row = bench(port, rate, args.bytes)
+            if row is None:
+                print("%8d rejected by the controller" % rate)
+                continue
+            rate, device_rate, host_rate, efficiency, errors = row
+            if device_rate is None:
+                print("%8d no result (%d bytes bad or missing)" % (rate, errors))
+                # The controller may have switched - try to get it back
+                port.baudrate = rate
+            else:
+                print("%8d %12d %12.0f %8.1f%% %7d" % (rate, device_rate, host_rate,
+                                                     efficiency, errors))
+            sys.stdout.flush()
+        if port.baudrate != args.baud and command(port, "baud %d" % args.baud):
+            port.baudrate = args.baud
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""
+telemetry_decode.py
+
+Decodes the binary telemetry stream sent by the elevator controller when
+binary mode is enabled (serial command "telemetry 1"). See telemetry.h for
+the record format.
+
+Trace event names are checked against trace.c (when it can be found
+next to the tools directory, or is given with --trace-source) so that a
+mismatch is reported rather than events being shown under the wrong name.
+
+Usage:
+    telemetry_decode.py capture.bin           decode a captured stream
+    telemetry_decode.py < capture.bin         decode from stdin
+    telemetry_decode.py --port /dev/ttyUSB0   read live (needs pyserial)
+"""
+
+import argparse
+import os
+import re
+import sys
+
+TLM_POSITION = 1
+TLM_DIRECTION = 2
+TLM_QUEUE = 3
+TLM_DOOR = 4
+TLM_METRICS = 5
+TLM_REPLY = 6
+TLM_TRACE = 8
+
+DIRECTIONS = {0: "Stationary", 1: "Up", 2: "Down"}
+# Trace event names in TraceEvent order (trace.h), starting from 1
+TRACE_EVENTS = ["button", "rx", "enqueue", "pickup", "dropoff", "door",
+                "door_end", "tone", "overflow", "switch"]
+
+EVENT_NAMES_PATTERN = re.compile(r"event_names\[\]\[\d+\]\s*PROGMEM\s*=\s*\{(.*?)\};", re.DOTALL)
+
+
+def check_trace_events(path):
+    """Return a description of how TRACE_EVENTS differs from the
+    event_names table in trace.c, or None if they match."""
+    with open(path) as source:
+        match = EVENT_NAMES_PATTERN.search(source.read())
+    if not match:
+        return "no event_names table found in %s" % path
+    names = re.findall(r'"([^"]*)"', match.group(1))
+    if names != TRACE_EVENTS:
+        return "trace events in %s are %s, but the decoder has %s" % (
+            path, ", ".join(names), ", ".join(TRACE_EVENTS))
+    return None
+
+
+def crc8_ccitt(data):
+    """CRC-8 with polynomial 0x07 and initial value 0 (avr-libc
+    _crc8_ccitt_update)."""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def cobs_decode(frame):
+    """Decode one COBS frame (without the 0x00 delimiter). Returns None if
+    the frame is malformed."""
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame) + 1:
+            return None
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def describe(record_type, payload):
+    """Return a readable description of a record payload."""
+    if record_type == TLM_POSITION and len(payload) == 2:
+        return "position row=%d floor=%d" % (payload[0], payload[1])
+    if record_type == TLM_DIRECTION and len(payload) == 1:
+        return "direction %s" % DIRECTIONS.get(payload[0], payload[0])
+    if record_type == TLM_QUEUE and len(payload) >= 1:
+        travellers = ["%d->%d" % (b >> 4, b & 0x0F) for b in payload[1:]]
+        return "queue count=%d [%s]" % (payload[0], " ".join(travellers))
+    if record_type == TLM_DOOR and len(payload) == 1:
+        return "door %s" % ("opening" if payload[0] else "closed")
+    if record_type == TLM_METRICS and len(payload) == 4:
+        return "metrics with=%d without=%d overruns=%d" % (
+            payload[0], payload[1], payload[2] | (payload[3] << 8))
+    if record_type == TLM_REPLY and len(payload) == 2:
+        return "reply command=%d %s" % (payload[0], "OK" if payload[1] else "ERR")
+    if record_type == TLM_TRACE and len(payload) % 4 == 1:
+        lines = []
+        for n in range(1, len(payload), 4):
+            delta, event, arg = payload[n] | (payload[n + 1] << 8), payload[n + 2], payload[n + 3]
+            name = TRACE_EVENTS[event - 1] if 1 <= event <= len(TRACE_EVENTS) else str(event)
+            lines.append("trace %d: +%d %s %d" % (payload[0] + (n - 1) // 4, delta, name, arg))
+        return "\n    ".join(lines)
+    return "type=%d payload=%s" % (record_type, payload.hex())
+
+
+class Decoder:
+    """Splits a byte stream into frames and decodes each record."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.expected_sequence = None
+        self.bad_frames = 0
+        self.lost_records = 0
+
+    def feed(self, data):
+        """Add received bytes. Yields (type, sequence, payload) for each
+        good record."""
+        for byte in data:
+            if byte != 0:
+                self.buffer.append(byte)
+                continue
+            frame = bytes(self.buffer)
+            self.buffer.clear()
+            if not frame:
+                continue
+            record = cobs_decode(frame)
+            if record is None or len(record) < 3 or crc8_ccitt(record[:-1]) != record[-1]:
+                # Text output (or line noise) also ends up here
+                self.bad_frames += 1
+                continue
+            record_type, sequence, payload = record[0], record[1], record[2:-1]
+            if self.expected_sequence is not None and sequence != self.expected_sequence:
+                self.lost_records += (sequence - self.expected_sequence) & 0xFF
+            self.expected_sequence = (sequence + 1) & 0xFF
+            yield record_type, sequence, payload
+
+
+def read_chunks(args):
+    if args.port:
+        import serial  # pyserial
+        with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+            while True:
+                yield port.read(256)
+    else:
+        stream = open(args.file, "rb") if args.file else sys.stdin.buffer
+        while True:
+            chunk = stream.read(256)
+            if not chunk:
+                return
+            yield chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", nargs="?", help="captured stream (default stdin)")
+    parser.add_argument("--port", help="serial port to read live")
+    parser.add_argument("--baud", type=int, default=19200)
+    parser.add_argument("--trace-source", default=os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), os.pardir, "trace.c"),
+        help="trace.c to check the trace event names against")
+    args = parser.parse_args()
+
+    if os.path.exists(args.trace_source):
+        problem = check_trace_events(args.trace_source)
+        if problem:
+            sys.exit("telemetry_decode: %s" % problem)
+
+    decoder = Decoder()
+    try:
+        for chunk in read_chunks(args):
+            for record_type, sequence, payload in decoder.feed(chunk):
+                print("%3d %s" % (sequence, describe(record_type, payload)))
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    print("bad frames: %d, lost records: %d" % (decoder.bad_frames, decoder.lost_records),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,96 @@
+/*
+ * trace.c
+ *
+ * Author: Yiyang Yu
+ *
+ * See trace.h
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "trace.h"
+#include "timer0.h"
+
+#define TRACE_MASK (TRACE_SIZE - 1)
+
+static TraceRecord trace_ring[TRACE_SIZE];
+static uint8_t trace_head;		// Where the next record goes
+static uint8_t trace_records;	// Number of records held
+static uint16_t last_time;		// Time of the last record
+static volatile uint8_t held;
+
+// Event names in TraceEvent order (starting from TRACE_BUTTON)
+static const char event_names[][9] PROGMEM = {
+	"button",
+	"rx",
+	"enqueue",
+	"pickup",
+	"dropoff",
+	"door",
+	"door_end",
+	"tone",
+	"overflow",
+	"switch"
+};
+static const char unknown_name[] PROGMEM = "?";
+
+_Static_assert(sizeof(event_names) / sizeof(event_names[0]) == TRACE_LAST_EVENT - TRACE_BUTTON + 1,
+	"event_names doesn't match TraceEvent");
+
+void trace_event(TraceEvent type, uint8_t arg) {
+	// Turn interrupts off (if on) so that an interrupt handler can't
+	// record an event halfway through this one
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	if (!held) {
+		uint16_t now = get_clock_ticks_low();
+		TraceRecord* record = &trace_ring[trace_head];
+		record->delta = now - last_time;
+		record->type = type;
+		record->arg = arg;
+		last_time = now;
+		trace_head = (trace_head + 1) & TRACE_MASK;
+		if (trace_records < TRACE_SIZE) {
+			trace_records++;
+		}
+	}
+	if (interrupts_were_enabled) {
+		sei();
+	}
+}
+
+void trace_hold(uint8_t hold) {
+	held = hold;
+}
+
+uint8_t trace_count(void) {
+	return trace_records;
+}
+
+void trace_get(uint8_t index, TraceRecord* record) {
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	*record = trace_ring[(trace_head - trace_records + index) & TRACE_MASK];
+	if (interrupts_were_enabled) {
+		sei();
+	}
+}
+
+void trace_clear(void) {
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	trace_records = 0;
+	if (interrupts_were_enabled) {
+		sei();
+	}
+}
+
+const char* trace_event_name(uint8_t type) {
+	if (type < TRACE_BUTTON || type > TRACE_LAST_EVENT) {
+		return unknown_name;
+	}
+	return event_names[type - TRACE_BUTTON];
+}
@@ -0,0 +1,76 @@
+/*
+ * trace.h
+ *
+ * Author: Yiyang Yu
+ *
+ * In-RAM event trace. The last TRACE_SIZE events are kept in a circular
+ * buffer of 4 byte records (milliseconds since the previous event, event
+ * type and an 8 bit argument). Recording an event just copies a record
+ * with interrupts briefly disabled, so it is cheap enough to leave on all
+ * the time and may be called from interrupt handlers. The buffer can be
+ * read back (e.g. dumped over serial) with trace_get().
+ *
+ * The time delta is 16 bits, so gaps of more than 65.5 seconds between
+ * events wrap around.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+// Number of records kept - must be a power of two no larger than 128
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 32
+#endif
+
+typedef enum {
+	TRACE_BUTTON = 1,		// arg = button (0-3)
+	TRACE_SERIAL_RX,		// arg = character received (recorded when it is read)
+	TRACE_ENQUEUE,			// arg = (origin floor << 4) | destination floor
+	TRACE_PICKUP,			// arg = floor
+	TRACE_DROPOFF,			// arg = floor
+	TRACE_DOOR_START,		// arg = floor
+	TRACE_DOOR_END,			// arg = floor
+	TRACE_TONE,				// arg = frequency / 100
+	TRACE_OVERFLOW,			// arg = TRACE_OVERFLOW_xxx
+	TRACE_SWITCH			// arg = new switch state (INPUT_Sx bits)
+} TraceEvent;
+// Keep up to date when adding events (and add their names to trace.c and
+// tools/telemetry_decode.py)
+#define TRACE_LAST_EVENT TRACE_SWITCH
+
+#define TRACE_OVERFLOW_BUTTONS 0	// Button queue full
+#define TRACE_OVERFLOW_SERIAL_RX 1	// Serial input buffer full
+#define TRACE_OVERFLOW_TRAVELLERS 2	// Traveller queue full
+
+typedef struct {
+	uint16_t delta;	// ms since the previous record
+	uint8_t type;	// TraceEvent
+	uint8_t arg;
+} TraceRecord;
+
+/* Add an event to the trace (overwriting the oldest if the trace is full).
+ * May be called with interrupts enabled or disabled, including from
+ * interrupt handlers.
+ */
+void trace_event(TraceEvent type, uint8_t arg);
+
+/* Stop (non-zero) or restart (0) recording, e.g. while the trace
+ * is being read.
+ */
+void trace_hold(uint8_t hold);
+
+/* Return the number of records held (up to TRACE_SIZE). */
+uint8_t trace_count(void);
+
+/* Copy record number index (0 is the oldest) to *record. */
+void trace_get(uint8_t index, TraceRecord* record);
+
+/* Discard all records. */
+void trace_clear(void);
+
+/* Return a short name (in program memory) for an event type. */
+const char* trace_event_name(uint8_t type);
+
+#endif /* TRACE_H_ */